@@ -0,0 +1,142 @@
+//
+// Benchmark: "3D" floor
+// (c) 2019 Jani Nykänen
+//
+
+#include <engine/graphics.h>
+#include <engine/mathext.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Number of frames drawn
+#define FRAME_COUNT 5000
+
+// Floor parameters, the same as in the game
+#define FLOOR_Y 160
+#define FLOOR_W 256
+#define FLOOR_H 32
+#define FLOOR_MX 64
+#define FLOOR_MY 1728
+
+
+// The old per-pixel floor routine, for comparison
+static void draw_floor_reference(Graphics* g, Bitmap* bmp,
+    int dx, int dy, int w, int h, int xdelta,
+    int mx, int my) {
+
+    int x, y;
+    int tx, ty;
+    int px, py;
+
+    int yjumpDelta = (int)mx / h;
+    int yjump = FIXED_PREC;
+
+    int xjumpDelta = (int)(my-FIXED_PREC) / h;
+    int xjump = (int)my;
+
+    ty = 0;
+    for (y = dy; y < dy + h; ++ y) {
+
+        py = round_fixed(ty, FIXED_PREC) % bmp->height;
+        tx = -w/2 * yjump;
+        for (x = dx; x < dx + w; ++ x) {
+
+            px = ((round_fixed(tx, FIXED_PREC))-xdelta) % bmp->width;
+            if (px < 0) px += bmp->width;
+
+            g->pdata[y*g->csize.x + x] = bmp->data[py * bmp->width + px];
+
+            tx += yjump;
+        }
+        ty += xjump;
+
+        xjump -= xjumpDelta;
+        yjump -= yjumpDelta;
+    }
+}
+
+
+// Get time in microseconds
+static double get_time() {
+
+    return (double)SDL_GetPerformanceCounter() * 1000000.0 /
+        (double)SDL_GetPerformanceFrequency();
+}
+
+
+int main(int argc, char** argv) {
+
+    int i;
+    double start, ref, tables;
+    uint8* expected;
+    int size;
+
+    // Headless, no window needed
+    Config conf = create_config();
+    if (init_graphics_global() != 0) {
+
+        printf("Failed to initialize graphics.\n");
+        return 1;
+    }
+    Graphics* g = create_graphics(NULL, &conf);
+    Bitmap* bmp = create_bitmap(64, 64);
+    if (g == NULL || bmp == NULL) {
+
+        printf("Failed to create graphics.\n");
+        return 1;
+    }
+    for (i = 0; i < bmp->width*bmp->height; ++ i) {
+
+        bmp->data[i] = (uint8)(i * 37 + i / 64);
+    }
+
+    // Check that the results are the same
+    size = g->csize.x*g->csize.y;
+    expected = (uint8*)malloc(size);
+    for (i = 0; i < 256; ++ i) {
+
+        draw_floor_reference(g, bmp, 0, FLOOR_Y, FLOOR_W, FLOOR_H,
+            -i, FLOOR_MX, FLOOR_MY);
+        memcpy(expected, g->pdata, size);
+
+        memset(g->pdata, 0, size);
+        g_draw_3D_floor(g, bmp, 0, FLOOR_Y, FLOOR_W, FLOOR_H,
+            -i, FLOOR_MX, FLOOR_MY);
+        if (memcmp(expected, g->pdata, size) != 0) {
+
+            printf("Output differs with xdelta %d!\n", -i);
+            return 1;
+        }
+    }
+
+    // Time both
+    start = get_time();
+    for (i = 0; i < FRAME_COUNT; ++ i) {
+
+        draw_floor_reference(g, bmp, 0, FLOOR_Y, FLOOR_W, FLOOR_H,
+            -i, FLOOR_MX, FLOOR_MY);
+    }
+    ref = (get_time() - start) / FRAME_COUNT;
+
+    start = get_time();
+    for (i = 0; i < FRAME_COUNT; ++ i) {
+
+        g_draw_3D_floor(g, bmp, 0, FLOOR_Y, FLOOR_W, FLOOR_H,
+            -i, FLOOR_MX, FLOOR_MY);
+    }
+    tables = (get_time() - start) / FRAME_COUNT;
+
+    printf("3D floor, %dx%d pixels, %d frames\n",
+        FLOOR_W, FLOOR_H, FRAME_COUNT);
+    printf("  per pixel:  %8.2f us/frame\n", ref);
+    printf("  row tables: %8.2f us/frame (%.1fx)\n", tables, ref / tables);
+
+    free(expected);
+    destroy_bitmap(bmp);
+    dispose_graphics(g);
+    destroy_global_graphics();
+
+    return 0;
+}
@@ -0,0 +1,233 @@
+//
+// Benchmark: drawing primitives
+// (c) 2019 Jani Nykänen
+//
+
+#include <engine/graphics.h>
+#include <engine/mathext.h>
+#include <engine/err.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Time spent on every primitive, in microseconds
+#define CASE_TIME 250000.0
+// Draw calls between checking the time
+#define BATCH_SIZE 16
+
+// Bitmaps, loaded from the game assets
+static Bitmap* bmpBunny;
+static Bitmap* bmpSpikeball;
+static Bitmap* bmpSky;
+static Bitmap* bmpChain;
+static Bitmap* bmpFloor;
+static Bitmap* bmpFont;
+
+// Parameters, the same as in the game
+static const char* TEXT = "SCORE: 0012345";
+static const int TRIANGLE_RADIUS = 48;
+static const int TRIANGLE_SKEW = 8;
+static const int CHAIN_LENGTH = 96;
+static const int CHAIN_WIDTH = 12;
+static const int CIRCLE_RADIUS = 80;
+
+// A primitive to time
+typedef struct {
+
+    const char* name;
+    void (*draw) (Graphics* g, int frame);
+    // Pixels covered by one draw call
+    int pixels;
+
+} BenchCase;
+
+
+// Get time in microseconds
+static double get_time() {
+
+    return (double)SDL_GetPerformanceCounter() * 1000000.0 /
+        (double)SDL_GetPerformanceFrequency();
+}
+
+
+//
+// Primitives
+//
+
+static void draw_region(Graphics* g, int frame) {
+
+    g_draw_bitmap_region(g, bmpBunny, (frame % 4) * 48, 0, 48, 48,
+        16 + frame % 160, 96, frame & 1);
+}
+
+
+static void draw_region_darken(Graphics* g, int frame) {
+
+    g_set_pixel_function(g, PixelFunctionDarken, 4, 0);
+    draw_region(g, frame);
+    g_set_pixel_function(g, PixelFunctionDefault, 0, 0);
+}
+
+
+static void draw_scaled(Graphics* g, int frame) {
+
+    g_draw_scaled_bitmap_region(g, bmpSpikeball, 0, 0, 48, 48,
+        16 + frame % 160, 64, 64, 64, frame & 1);
+}
+
+
+static void draw_fast(Graphics* g, int frame) {
+
+    g_draw_bitmap_fast(g, bmpSky, 0, 16);
+}
+
+
+static void draw_triangle(Graphics* g, int frame) {
+
+    g_draw_triangle(g,
+        128, 96,
+        128 + TRIANGLE_RADIUS, 96 + TRIANGLE_SKEW,
+        128 + TRIANGLE_SKEW*2, 96 + TRIANGLE_RADIUS,
+        (uint8)frame);
+}
+
+
+static void draw_textured_triangle(Graphics* g, int frame) {
+
+    g_toggle_texturing(g, bmpChain);
+    g_set_uv_coords(g, 0, 0, 0, 2.0f, 1.0f, 2.0f);
+    g_draw_triangle(g,
+        64, 64,
+        64, 64 + CHAIN_LENGTH,
+        64 + CHAIN_WIDTH, 64 + CHAIN_LENGTH, 0);
+    g_toggle_texturing(g, NULL);
+}
+
+
+static void draw_floor(Graphics* g, int frame) {
+
+    g_draw_3D_floor(g, bmpFloor, 0, 160, 256, 32, -frame, 64, 1728);
+}
+
+
+static void draw_darken(Graphics* g, int frame) {
+
+    g_darken(g, frame % 8);
+}
+
+
+static void draw_zoom(Graphics* g, int frame) {
+
+    float t = (float)(frame % 60) / 60.0f;
+
+    g_fill_zoomed_rotated(g, bmpSky, -t * (float)M_PI,
+        1.0f - t * 0.75f, 1.0f - t * 0.75f);
+}
+
+
+static void draw_circle(Graphics* g, int frame) {
+
+    g_fill_circle_outside(g, CIRCLE_RADIUS, 0);
+}
+
+
+static void draw_text(Graphics* g, int frame) {
+
+    g_draw_text(g, bmpFont, TEXT, 8, 8 + frame % 160, 0, 0, false);
+}
+
+
+// Time a primitive
+static void run_case(Graphics* g, BenchCase* c) {
+
+    int i;
+    int calls = 0;
+    double start = get_time();
+    double time;
+    double ns;
+
+    do {
+
+        for (i = 0; i < BATCH_SIZE; ++ i) {
+
+            c->draw(g, calls ++);
+        }
+        time = get_time() - start;
+    }
+    while (time < CASE_TIME);
+
+    ns = time * 1000.0 / ((double)calls * c->pixels);
+    printf("  %-20s %8d px %10.3f ns/pixel %10.1f Mpixels/s\n",
+        c->name, c->pixels, ns, 1000.0 / ns);
+}
+
+
+int main(int argc, char** argv) {
+
+    int i;
+
+    Config conf = create_config();
+    if (init_graphics_global() != 0) {
+
+        printf("Failed to initialize graphics.\n");
+        return 1;
+    }
+    // Headless, no window needed
+    Graphics* g = create_graphics(NULL, &conf);
+    if (g == NULL) {
+
+        printf("Failed to create graphics.\n");
+        return 1;
+    }
+
+    bmpBunny = load_bitmap("assets/bitmaps/bunny.png", false);
+    bmpSpikeball = load_bitmap("assets/bitmaps/spikeball.png", false);
+    bmpSky = load_bitmap("assets/bitmaps/sky.png", true);
+    bmpChain = load_bitmap("assets/bitmaps/chain.png", false);
+    bmpFloor = load_bitmap("assets/bitmaps/floor.png", false);
+    bmpFont = load_bitmap("assets/bitmaps/font.png", false);
+    if (bmpBunny == NULL || bmpSpikeball == NULL || bmpSky == NULL ||
+        bmpChain == NULL || bmpFloor == NULL || bmpFont == NULL) {
+
+        printf("Failed to load bitmaps: %s\n", get_error());
+        return 1;
+    }
+
+    int cw = bmpFont->width / 16;
+    BenchCase cases[] = {
+
+        {"bitmap region", draw_region, 48*48},
+        {"bitmap region, dark", draw_region_darken, 48*48},
+        {"scaled region", draw_scaled, 64*64},
+        {"fast bitmap", draw_fast, bmpSky->width*bmpSky->height},
+        {"triangle", draw_triangle,
+            (TRIANGLE_RADIUS*TRIANGLE_RADIUS - 
+             TRIANGLE_SKEW*TRIANGLE_SKEW*2) / 2},
+        {"textured triangle", draw_textured_triangle,
+            CHAIN_LENGTH*CHAIN_WIDTH/2},
+        {"3D floor", draw_floor, 256*32},
+        {"darken", draw_darken, g->csize.x*g->csize.y},
+        {"zoom & rotate", draw_zoom, g->csize.x*g->csize.y},
+        {"circle outside", draw_circle, g->csize.x*g->csize.y -
+            (int)(M_PI*CIRCLE_RADIUS*CIRCLE_RADIUS)},
+        {"text", draw_text, (int)strlen(TEXT)*cw*cw},
+    };
+
+    printf("Drawing primitives, %dx%d canvas\n", g->csize.x, g->csize.y);
+    for (i = 0; i < (int)(sizeof(cases)/sizeof(BenchCase)); ++ i) {
+
+        run_case(g, &cases[i]);
+    }
+
+    destroy_bitmap(bmpBunny);
+    destroy_bitmap(bmpSpikeball);
+    destroy_bitmap(bmpSky);
+    destroy_bitmap(bmpChain);
+    destroy_bitmap(bmpFloor);
+    destroy_bitmap(bmpFont);
+    dispose_graphics(g);
+    destroy_global_graphics();
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+//
+// Benchmark: zoomed & rotated fill
+// (c) 2019 Jani Nykänen
+//
+
+#include <engine/graphics.h>
+#include <engine/mathext.h>
+
+#include <math.h>
+#include <stdio.h>
+
+// Number of frames drawn per test
+#define FRAME_COUNT 200
+
+// Size of the power of two source bitmap
+#define POW2_SIZE 64
+
+
+// Modulo that is always positive
+static int wrap(int m, int n) {
+
+    m %= n;
+    return m < 0 ? m + n : m;
+}
+
+
+// The old per-pixel routine, for comparison
+static void fill_zoomed_rotated_reference(Graphics* g, Bitmap* bmp,
+    float angle, float sx, float sy) {
+
+    int x, y;
+    int px, py;
+    int tx, ty;
+    int offset;
+
+    Point tr = point(bmp->width/2, bmp->height/2);
+
+    int s = (int) (sinf(angle) * FIXED_PREC);
+    int c = (int) (cosf(angle) * FIXED_PREC);
+
+    int scalex = (int) (sx * FIXED_PREC);
+    int scaley = (int) (sy * FIXED_PREC);
+
+    for (y = 0; y < g->csize.y; ++ y) {
+
+        for (x = 0; x < g->csize.x; ++ x) {
+
+            px = (x-tr.x) * scalex / FIXED_PREC;
+            py = (y-tr.y) * scaley / FIXED_PREC;
+
+            tx = ( px * c - py * s) / FIXED_PREC;
+            ty = ( px * s + py * c) / FIXED_PREC;
+
+            tx -= tr.x;
+            ty -= tr.y;
+
+            tx = wrap(tx, bmp->width);
+            ty = wrap(ty, bmp->height);
+
+            offset = y * g->csize.x + x;
+            g->pdata[offset] = bmp->data[ty*bmp->width + tx];
+        }
+    }
+}
+
+
+// Get time in microseconds
+static double get_time() {
+
+    return (double)SDL_GetPerformanceCounter() * 1000000.0 /
+        (double)SDL_GetPerformanceFrequency();
+}
+
+
+// Transition parameters for the given frame
+static void get_params(int frame, float* angle, float* scale) {
+
+    float t = (float)(frame % 60) / 60.0f;
+
+    *angle = -t * (float)M_PI * 2.0f;
+    *scale = 1.0f - t * 0.75f;
+}
+
+
+// Time both routines with the given source
+static void run_test(Graphics* g, Bitmap* bmp, const char* name) {
+
+    int i;
+    float angle, scale;
+    double start, ref, dda;
+
+    start = get_time();
+    for (i = 0; i < FRAME_COUNT; ++ i) {
+
+        get_params(i, &angle, &scale);
+        fill_zoomed_rotated_reference(g, bmp, angle, scale, scale);
+    }
+    ref = (get_time() - start) / FRAME_COUNT;
+
+    start = get_time();
+    for (i = 0; i < FRAME_COUNT; ++ i) {
+
+        get_params(i, &angle, &scale);
+        g_fill_zoomed_rotated(g, bmp, angle, scale, scale);
+    }
+    dda = (get_time() - start) / FRAME_COUNT;
+
+    printf("Zoom & rotate, %dx%d canvas, %s source (%dx%d)\n",
+        g->csize.x, g->csize.y, name, bmp->width, bmp->height);
+    printf("  per pixel:  %8.2f us/frame\n", ref);
+    printf("  stepped:    %8.2f us/frame (%.1fx)\n", dda, ref / dda);
+}
+
+
+// Run the tests with the given canvas size
+static int run_tests(int w, int h) {
+
+    int i;
+    char buf [16];
+
+    Config conf = create_config();
+    snprintf(buf, 16, "%d", w);
+    conf_add_param(&conf, "canvas_width", buf);
+    snprintf(buf, 16, "%d", h);
+    conf_add_param(&conf, "canvas_height", buf);
+
+    // Headless, no window needed
+    Graphics* g = create_graphics(NULL, &conf);
+    Bitmap* bmp = create_bitmap(POW2_SIZE, POW2_SIZE);
+    if (g == NULL || bmp == NULL) {
+
+        printf("Failed to create graphics.\n");
+        return 1;
+    }
+    for (i = 0; i < POW2_SIZE*POW2_SIZE; ++ i) {
+
+        bmp->data[i] = (uint8)(i * 37 + i / POW2_SIZE);
+    }
+    for (i = 0; i < w*h; ++ i) {
+
+        g->pdata[i] = (uint8)(i * 7 + i / w);
+    }
+    g_copy_to_buffer(g);
+
+    // The transition uses a copy of the canvas
+    run_test(g, &g->bufferCopy, "canvas");
+    run_test(g, bmp, "power of two");
+
+    destroy_bitmap(bmp);
+    dispose_graphics(g);
+
+    return 0;
+}
+
+
+int main(int argc, char** argv) {
+
+    if (init_graphics_global() != 0) {
+
+        printf("Failed to initialize graphics.\n");
+        return 1;
+    }
+
+    if (run_tests(256, 192) != 0 ||
+        run_tests(1024, 768) != 0) {
+
+        return 1;
+    }
+
+    destroy_global_graphics();
+
+    return 0;
+}
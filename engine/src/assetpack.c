@@ -0,0 +1,314 @@
+#include "assetpack.h"
+
+#include "err.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL2/SDL_mixer.h>
+
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WIN32
+
+
+#ifndef _WIN32
+
+// Map a file to memory
+static int map_file(AssetPack* p, const char* path) {
+
+    struct stat st;
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+
+        return -1;
+    }
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+
+        close(fd);
+        return -1;
+    }
+    p->size = (size_t)st.st_size;
+
+    // Read only, nothing is supposed
+    // to modify the assets
+    p->data = (uint8*)mmap(NULL, p->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p->data == (uint8*)MAP_FAILED) {
+
+        p->data = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+// Unmap a file
+static void unmap_file(AssetPack* p) {
+
+    munmap(p->data, p->size);
+}
+
+#else
+
+// No mmap, read the whole file instead
+static int map_file(AssetPack* p, const char* path) {
+
+    long size;
+
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size <= 0) {
+
+        fclose(f);
+        return -1;
+    }
+    p->size = (size_t)size;
+
+    p->data = (uint8*)malloc(p->size);
+    if (p->data == NULL ||
+        fread(p->data, 1, p->size, f) != p->size) {
+
+        free(p->data);
+        p->data = NULL;
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    return 0;
+}
+
+
+// Free the file data
+static void unmap_file(AssetPack* p) {
+
+    free(p->data);
+}
+
+#endif // _WIN32
+
+
+// Check that the runs of a bitmap stay
+// inside their rows and the bitmap
+static bool check_runs(PackBitmap* b) {
+
+    uint32 y, i;
+    uint32* runRows = (uint32*)(b + 1);
+    uint16* runs = (uint16*)(runRows + b->height+1);
+
+    if (runRows[0] != 0 || runRows[b->height] != b->runCount)
+        return false;
+
+    for (y = 0; y < b->height; ++ y) {
+
+        if (runRows[y] > runRows[y+1])
+            return false;
+    }
+
+    for (i = 0; i < b->runCount; ++ i) {
+
+        if ((uint32)runs[i*2] + runs[i*2 +1] > b->width)
+            return false;
+    }
+
+    return true;
+}
+
+
+// Check that the entries point inside the file
+static bool check_entries(AssetPack* p) {
+
+    uint32 i;
+    PackEntry* e;
+    PackBitmap* b;
+    size_t size;
+
+    for (i = 0; i < p->header->entryCount; ++ i) {
+
+        e = &p->entries[i];
+        if (e->offset % PACK_ALIGN != 0 ||
+            (size_t)e->offset + e->size > p->size) {
+
+            return false;
+        }
+
+        if (e->type == PackTypeBitmap) {
+
+            if (e->size < sizeof(PackBitmap))
+                return false;
+
+            b = (PackBitmap*)(p->data + e->offset);
+            size = sizeof(PackBitmap) +
+                sizeof(uint32) * (b->height+1) +
+                sizeof(uint16) * 2 * b->runCount +
+                (size_t)b->width * b->height;
+            if (size > e->size || !check_runs(b))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Open a pack file
+AssetPack* open_asset_pack(const char* path) {
+
+    int freq, channels;
+    Uint16 format;
+
+    // Allocate memory
+    AssetPack* p = (AssetPack*)malloc(sizeof(AssetPack));
+    if (p == NULL) {
+
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
+
+    if (map_file(p, path) == -1) {
+
+        err_throw_param_1("Failed to open a file in ", path);
+        free(p);
+        return NULL;
+    }
+
+    // Check header
+    p->header = (PackHeader*)p->data;
+    p->entries = (PackEntry*)(p->data + sizeof(PackHeader));
+    if (p->size < sizeof(PackHeader) ||
+        memcmp(p->header->magic, PACK_MAGIC, 4) != 0 ||
+        p->header->version != PACK_VERSION ||
+        p->header->entryCount >
+            (p->size - sizeof(PackHeader)) / sizeof(PackEntry) ||
+        !check_entries(p)) {
+
+        err_throw_param_1("Not an asset pack: ", path);
+        unmap_file(p);
+        free(p);
+        return NULL;
+    }
+
+    // The samples can be used only if the mixer
+    // plays the format they were converted to
+    p->samplesUsable = Mix_QuerySpec(&freq, &format, &channels) != 0 &&
+        (uint32)freq == p->header->sampleFreq &&
+        (uint32)format == p->header->sampleFormat &&
+        (uint32)channels == p->header->sampleChannels;
+
+    return p;
+}
+
+
+// Close a pack
+void dispose_asset_pack(AssetPack* p) {
+
+    if (p == NULL) return;
+
+    unmap_file(p);
+    free(p);
+}
+
+
+// Get the size and modification time of a file
+int pack_get_source_info(const char* path, 
+    uint32* size, uint32* time) {
+
+    struct stat st;
+
+    if (stat(path, &st) == -1) {
+
+        return -1;
+    }
+    *size = (uint32)st.st_size;
+    *time = (uint32)st.st_mtime;
+
+    return 0;
+}
+
+
+// Find an asset made from the given file
+PackEntry* pack_find(AssetPack* p, int type,
+    const char* name, const char* path, uint32 flag) {
+
+    uint32 i;
+    PackEntry* e;
+    uint32 size, time;
+
+    for (i = 0; i < p->header->entryCount; ++ i) {
+
+        e = &p->entries[i];
+        if (e->type == (uint32)type &&
+            strncmp(e->name, name, PACK_NAME_LENGTH) == 0) {
+
+            // Made from a different file or
+            // with different settings
+            if (e->flag != flag ||
+                strncmp(e->path, path, PACK_PATH_LENGTH) != 0) {
+
+                return NULL;
+            }
+            // The file has been edited. If it is
+            // not there at all, the pack is used
+            if (pack_get_source_info(path, &size, &time) == 0 &&
+                (size != e->sourceSize || time != e->sourceTime)) {
+
+                return NULL;
+            }
+            return e;
+        }
+    }
+    return NULL;
+}
+
+
+// Create a bitmap from packed data
+Bitmap* pack_get_bitmap(AssetPack* p, PackEntry* e) {
+
+    uint8* data = p->data + e->offset;
+    PackBitmap* b = (PackBitmap*)data;
+
+    // Allocate memory
+    Bitmap* bmp = (Bitmap*)malloc(sizeof(Bitmap));
+    if (bmp == NULL) {
+
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
+
+    bmp->width = b->width;
+    bmp->height = b->height;
+
+    // Point to the pack
+    data += sizeof(PackBitmap);
+    bmp->runRows = (uint32*)data;
+    data += sizeof(uint32) * (b->height+1);
+    bmp->runs = (uint16*)data;
+    data += sizeof(uint16) * 2 * b->runCount;
+    bmp->data = data;
+
+    bmp->shared = true;
+
+    return bmp;
+}
+
+
+// Create a sample from packed data
+Sample* pack_get_sample(AssetPack* p, PackEntry* e) {
+
+    if (!p->samplesUsable) return NULL;
+
+    return create_sample(p->data + e->offset, e->size);
+}
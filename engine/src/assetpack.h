@@ -0,0 +1,122 @@
+//
+// Asset pack
+// (c) 2019 Jani Nykänen
+//
+
+#ifndef __ASSET_PACK__
+#define __ASSET_PACK__
+
+#include "types.h"
+#include "bitmap.h"
+#include "sample.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// File format
+#define PACK_MAGIC "RRPK"
+#define PACK_VERSION 2
+// Payloads start at multiples of this
+#define PACK_ALIGN 8
+
+#define PACK_NAME_LENGTH 32
+#define PACK_PATH_LENGTH 128
+
+// Packed asset types
+enum {
+
+    PackTypeBitmap = 0,
+    PackTypeSample = 1,
+};
+
+// Pack file header, followed by the index
+// entries. Everything is stored in the byte
+// order of the machine that made the pack
+typedef struct {
+
+    char magic [4];
+    uint32 version;
+    uint32 entryCount;
+
+    // Mixer format the samples are converted to
+    uint32 sampleFreq;
+    uint32 sampleFormat;
+    uint32 sampleChannels;
+
+} PackHeader;
+
+// Index entry
+typedef struct {
+
+    char name [PACK_NAME_LENGTH];
+    // The file the asset was made from
+    char path [PACK_PATH_LENGTH];
+
+    uint32 type;
+    // Dithering, for bitmaps
+    uint32 flag;
+
+    // Payload position in the file
+    uint32 offset;
+    uint32 size;
+
+    // Size and modification time of the file,
+    // to notice if it has changed since
+    uint32 sourceSize;
+    uint32 sourceTime;
+
+} PackEntry;
+
+// Bitmap payload header. It is followed by the
+// run rows, the runs and the pixels, in the
+// same layout as in a Bitmap
+typedef struct {
+
+    uint16 width;
+    uint16 height;
+    uint32 runCount;
+
+} PackBitmap;
+
+// Asset pack type
+typedef struct {
+
+    // The whole file, mapped to memory
+    uint8* data;
+    size_t size;
+
+    PackHeader* header;
+    PackEntry* entries;
+
+    // Can the samples be played as they are
+    bool samplesUsable;
+
+} AssetPack;
+
+// Open a pack file
+AssetPack* open_asset_pack(const char* path);
+
+// Close a pack. The assets created from
+// it must be destroyed first
+void dispose_asset_pack(AssetPack* p);
+
+// Get the size and modification time of a file
+int pack_get_source_info(const char* path, 
+    uint32* size, uint32* time);
+
+// Find an asset made from the given file,
+// NULL if the pack does not have it or the
+// file has changed since the pack was made
+PackEntry* pack_find(AssetPack* p, int type,
+    const char* name, const char* path, uint32 flag);
+
+// Create a bitmap that uses the packed
+// data without copying it
+Bitmap* pack_get_bitmap(AssetPack* p, PackEntry* e);
+
+// Create a sample that plays the packed
+// data without copying it. NULL if the
+// mixer uses a different format
+Sample* pack_get_sample(AssetPack* p, PackEntry* e);
+
+#endif // __ASSET_PACK__
@@ -5,6 +5,8 @@
 #include "tilemap.h"
 #include "wordreader.h"
 #include "sample.h"
+#include "workerpool.h"
+#include "mathext.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -21,47 +23,119 @@ enum {
     TypeFlag = 4,
 };
 
+// Asset listed in a text file
+typedef struct {
+
+    char path [WR_WORD_LENGTH];
+    bool flag;
+    bool failed;
+
+} LoadEntry;
+
+// Assets to load, in consecutive slots
+typedef struct {
+
+    AssetManager* a;
+    LoadEntry* entries;
+    int first;
+    int count;
+
+} LoadJob;
+
 
 // Loading functions
-static void* cb_load_bitmap(const char* path, bool flag) {
+static void* cb_load_bitmap(AssetManager* a, 
+    const char* name, const char* path, bool flag) {
+
+    PackEntry* e;
+
+    if (a->pack != NULL &&
+        (e = pack_find(a->pack, PackTypeBitmap, name, path, flag)) != NULL) {
 
+        return (void*) pack_get_bitmap(a->pack, e);
+    }
     return (void*) load_bitmap(path, flag);
 }
-static void* cb_load_tilemap(const char* path, bool flag) {
+static void* cb_load_tilemap(AssetManager* a, 
+    const char* name, const char* path, bool flag) {
 
     return (void*) load_tilemap(path);
 }
-static void* cb_load_sample(const char* path, bool flag) {
+static void* cb_load_sample(AssetManager* a, 
+    const char* name, const char* path, bool flag) {
+
+    PackEntry* e;
+    Sample* s;
 
+    if (a->pack != NULL &&
+        (e = pack_find(a->pack, PackTypeSample, name, path, 0)) != NULL &&
+        (s = pack_get_sample(a->pack, e)) != NULL) {
+
+        return (void*) s;
+    }
     return (void*) load_sample(path);
 }
 
 
+// Loading functions by type
+static void* (* const LOADERS[]) (AssetManager*, 
+    const char*, const char*, bool) = {
+
+    cb_load_bitmap,
+    cb_load_tilemap,
+    cb_load_sample,
+};
+
+
+// Check if there is room for another asset
+static bool has_room(AssetManager* a) {
+
+    if (a->assetCount == MAX_ASSET_COUNT) {
+
+        err_throw_no_param("Asset manager storage is full.");
+        return false;
+    }
+    return true;
+}
+
+
+// Reserve a slot for an asset, the asset
+// is set later. Expects there to be room
+static int reserve_slot(AssetManager* a, const char* name, int type) {
+
+    int slot = a->assetCount ++;
+
+    a->assetTypes[slot] = type;
+    snprintf(a->assetNames[slot], MAX_ASSET_NAME_LENGTH, "%s", name);
+    a->assetPointers[slot] = NULL;
+
+    nindex_add(&a->index, slot, 
+        a->assetNames[0], MAX_ASSET_NAME_LENGTH);
+
+    return slot;
+}
+
+
 // Generic loading function
 int assets_add_generic(AssetManager* a, 
-    void* (*lfunc) (const char*, bool),
+    void* (*lfunc) (AssetManager*, const char*, const char*, bool),
     const char* name, const char* path,
     int type, bool flag) {
 
-    if (a->assetCount == MAX_ASSET_COUNT) {
+    if (!has_room(a)) {
 
-        err_throw_no_param("Asset manager storage is full.");
         return -1;
     }
 
     // Load
-    void* b = lfunc(path, flag);
+    void* b = lfunc(a, name, path, flag);
     if (b == NULL) {
 
         return -1;
     }
 
     // Put to the storage
-    a->assetTypes[a->assetCount] = type;
-    snprintf(a->assetNames[a->assetCount], 
-        MAX_ASSET_NAME_LENGTH, "%s", name);
-    a->assetPointers[a->assetCount] = (void*)b;
-    ++ a->assetCount;
+    a->assetPointers[reserve_slot(a, name, type)] = b;
 
     return 0;
 }
@@ -97,15 +171,26 @@ int assets_add_sample(AssetManager* a, const char* name, const char* path) {
 // Get an asset
 void* assets_get(AssetManager* a, const char* name) {
 
-    int i = 0;
-    for(; i < a->assetCount; ++ i) {
+    return assets_get_by_handle(a, assets_get_handle(a, name));
+}
 
-        if (strcmp(name, a->assetNames[i]) == 0) {
 
-            return a->assetPointers[i];
-        }
+// Get a handle to an asset
+int assets_get_handle(AssetManager* a, const char* name) {
+
+    return nindex_find(&a->index, name, 
+        a->assetNames[0], MAX_ASSET_NAME_LENGTH);
+}
+
+
+// Get an asset by its handle
+void* assets_get_by_handle(AssetManager* a, int handle) {
+
+    if (handle < 0 || handle >= a->assetCount) {
+
+        return NULL;
     }
-    return NULL;
+    return a->assetPointers[handle];
 }
 
 
@@ -140,11 +225,86 @@ void assets_dispose(AssetManager* a) {
         }
     }
 
+    // The packed assets are gone now
+    dispose_asset_pack(a->pack);
+
     // Destroy the manager itself
     free(a);
 }
 
 
+// Load the asset in a reserved slot
+static void job_load_asset(void* param, int index) {
+
+    LoadJob* job = (LoadJob*)param;
+    AssetManager* a = job->a;
+    LoadEntry* e = &job->entries[index];
+    int slot = job->first + index;
+
+    a->assetPointers[slot] = LOADERS[a->assetTypes[slot]] (
+        a, a->assetNames[slot], e->path, e->flag);
+    e->failed = a->assetPointers[slot] == NULL;
+
+    SDL_AtomicAdd(&a->loadDone, 1);
+}
+
+
+// Load the asset in a reserved slot, unless it is
+// a sample. SDL_mixer is not thread safe, so the
+// samples are left to the calling thread
+static void job_decode_asset(void* param, int index) {
+
+    LoadJob* job = (LoadJob*)param;
+
+    if (job->a->assetTypes[job->first + index] == TypeSample)
+        return;
+
+    job_load_asset(param, index);
+}
+
+
+// Load the listed assets, on several
+// threads if possible
+static int load_assets(AssetManager* a, LoadJob* job) {
+
+    int i;
+    WorkerPool* pool;
+
+    if (a->threadCount > 1 && job->count > 1) {
+
+        // The calling thread is one of the loaders
+        pool = create_worker_pool(
+            min_int32_2(a->threadCount, job->count) - 1);
+        if (pool == NULL) {
+
+            return -1;
+        }
+        pool_run(pool, job_decode_asset, (void*)job, job->count);
+        dispose_worker_pool(pool);
+
+        for (i = 0; i < job->count; ++ i) {
+
+            if (a->assetTypes[job->first + i] == TypeSample)
+                job_load_asset((void*)job, i);
+        }
+    }
+    else {
+
+        for (i = 0; i < job->count; ++ i) {
+
+            job_load_asset((void*)job, i);
+        }
+    }
+
+    for (i = 0; i < job->count; ++ i) {
+
+        if (job->entries[i].failed)
+            return -1;
+    }
+    return 0;
+}
+
+
 // Parse a text file
 int assets_parse_text_file(AssetManager* a, const char* path) {
 
@@ -157,12 +317,27 @@ int assets_parse_text_file(AssetManager* a, const char* path) {
 
     int type = TypeBitmap;
     int c = 0;
+    int ret = 0;
 
     char name [WR_WORD_LENGTH]; 
 
     // Render flags
     bool dithering = false;
 
+    // The assets are listed first, each in a slot
+    // of its own, and then loaded in parallel
+    LoadJob job;
+    job.a = a;
+    job.first = a->assetCount;
+    job.count = 0;
+    job.entries = (LoadEntry*)malloc(sizeof(LoadEntry) * MAX_ASSET_COUNT);
+    if (job.entries == NULL) {
+
+        ERR_MEM_ALLOC;
+        dispose_word_reader(wr);
+        return -1;
+    }
+
     while(wr_read_next(wr)) {
 
         // Type
@@ -190,28 +365,23 @@ int assets_parse_text_file(AssetManager* a, const char* path) {
 
             switch (type)
             {
-            // Bitmap
+            // Asset
             case TypeBitmap:
-                if (assets_add_bitmap(a, name, wr->word, dithering) == -1) {
-
-                    return -1;
-                }
-                break;
-
-            // Tilemap
             case TypeTilemap:
-                if (assets_add_tilemap(a, name, wr->word) == -1) {
-
-                    return -1;
-                }
-                break;
-
-            // Sample
             case TypeSample:
-                if (assets_add_sample(a, name, wr->word) == -1) {
 
-                    return -1;
+                if (!has_room(a)) {
+
+                    ret = -1;
+                    break;
                 }
+                reserve_slot(a, name, type);
+                snprintf(job.entries[job.count].path, 
+                    WR_WORD_LENGTH, "%s", wr->word);
+                // Only bitmaps are dithered
+                job.entries[job.count].flag = 
+                    type == TypeBitmap && dithering;
+                ++ job.count;
                 break;
             
             // Flag
@@ -229,6 +399,7 @@ int assets_parse_text_file(AssetManager* a, const char* path) {
             }
             
         }
+        if (ret == -1) break;
 
         ++ c;
         c %= 3;
@@ -237,7 +408,15 @@ int assets_parse_text_file(AssetManager* a, const char* path) {
     // Close
     dispose_word_reader(wr);
 
-    return 0;
+    // Load
+    if (ret == 0) {
+
+        SDL_AtomicAdd(&a->loadTotal, job.count);
+        ret = load_assets(a, &job);
+    }
+    free(job.entries);
+
+    return ret;
 }
 
 
@@ -248,6 +427,40 @@ void assets_set_path(AssetManager* a, char* path) {
 }
 
 
+// Open an asset pack to load the
+// assets from
+int assets_open_pack(AssetManager* a, const char* path) {
+
+    dispose_asset_pack(a->pack);
+
+    a->pack = open_asset_pack(path);
+    if (a->pack == NULL) {
+
+        return -1;
+    }
+    return 0;
+}
+
+
+// Set the number of threads used to load
+void assets_set_thread_count(AssetManager* a, int count) {
+
+    a->threadCount = max_int32_2(1, count);
+}
+
+
+// Get the share of the listed assets loaded
+float assets_get_progress(AssetManager* a) {
+
+    int total = SDL_AtomicGet(&a->loadTotal);
+    if (total == 0) {
+
+        return 0.0f;
+    }
+    return (float)SDL_AtomicGet(&a->loadDone) / (float)total;
+}
+
+
 // Create an asset manager
 AssetManager* create_asset_manager() {
 
@@ -258,6 +471,11 @@ AssetManager* create_asset_manager() {
         return NULL;
     }
     a->assetCount = 0;
+    init_name_index(&a->index);
+    a->pack = NULL;
+    a->threadCount = 1;
+    SDL_AtomicSet(&a->loadTotal, 0);
+    SDL_AtomicSet(&a->loadDone, 0);
 
     return a;
 }
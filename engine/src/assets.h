@@ -8,6 +8,10 @@
 #define __ASSETS__
 
 #include "types.h"
+#include "assetpack.h"
+#include "nameindex.h"
+
+#include <SDL2/SDL.h>
 
 #include <stdbool.h>
 
@@ -22,16 +26,28 @@ typedef struct
     // Asset names
     // TODO: Check order
     char assetNames [MAX_ASSET_COUNT] [MAX_ASSET_NAME_LENGTH];
+    // Asset indices by name
+    NameIndex index;
     // Asset types (defined in the source)
     int assetTypes [MAX_ASSET_COUNT];
     // Asset pointers
     void* assetPointers [MAX_ASSET_COUNT];
     // Asset path
     char assetPath [ASSET_PATH_LENGTH];
+    // Preconverted assets, used instead of
+    // the files when possible. NULL if none
+    AssetPack* pack;
     
     // Asset count
     int assetCount;
 
+    // Threads used to load text file assets
+    int threadCount;
+    // Assets listed in text files and
+    // the ones loaded so far
+    SDL_atomic_t loadTotal;
+    SDL_atomic_t loadDone;
+
 } AssetManager;
 
 // Load a bitmap and add it to the
@@ -50,15 +66,37 @@ int assets_add_sample(AssetManager* a, const char* name, const char* path);
 // Get an asset
 void* assets_get(AssetManager* a, const char* name);
 
+// Get a handle to an asset, -1 if there is no
+// asset of the name. Handles stay the same, so
+// they can be found once and then kept
+int assets_get_handle(AssetManager* a, const char* name);
+
+// Get an asset by its handle
+void* assets_get_by_handle(AssetManager* a, int handle);
+
 // Dispose assets
 void assets_dispose(AssetManager* a);
 
-// Parse a text file
+// Parse a text file and load the
+// assets listed in it
 int assets_parse_text_file(AssetManager* a, const char* path);
 
+// Set the number of threads used to load
+// the assets of a text file
+void assets_set_thread_count(AssetManager* a, int count);
+
+// Get the share of the assets in the text
+// files loaded so far, from 0 to 1. Can be
+// called while loading in another thread
+float assets_get_progress(AssetManager* a);
+
 // Set an asset path
 void assets_set_path(AssetManager* a, char* path);
 
+// Open an asset pack to load the
+// assets from
+int assets_open_pack(AssetManager* a, const char* path);
+
 // Create an asset manager
 AssetManager* create_asset_manager();
 
@@ -0,0 +1,159 @@
+#include "bandrenderer.h"
+
+#include "err.h"
+#include "mathext.h"
+#include "profiler.h"
+
+#include <stdlib.h>
+
+// Bands per thread, more than one so that
+// a thread with an easy band can take another
+#define BANDS_PER_THREAD 2
+// Minimum band height in pixels
+#define MIN_BAND_HEIGHT 8
+
+
+// Draw a band
+static void job_draw_band(void* param, int index) {
+
+    BandRenderer* br = (BandRenderer*)param;
+
+    Uint64 zone = prof_begin();
+    g_execute_commands(&br->bands[index], br->buf, br->begin, br->end);
+    prof_end("draw_band", zone);
+}
+
+
+// Draw commands in the range [begin, end) on all bands
+static void draw_commands(BandRenderer* br, uint32 begin, uint32 end) {
+
+    if (begin >= end) return;
+
+    br->begin = begin;
+    br->end = end;
+    pool_run(br->pool, job_draw_band, (void*)br, br->bandCount);
+}
+
+
+// Does the command need the whole canvas to be
+// ready, or build tables shared by the bands
+static bool is_barrier(uint32 type) {
+
+    return type == CommandCopyToBuffer || 
+        type == CommandFreezeBackdrop ||
+        type == Command3DFloor;
+}
+
+
+// Create a band renderer
+BandRenderer* create_band_renderer(Graphics* g, int threadCount) {
+
+    // Allocate memory
+    BandRenderer* br = (BandRenderer*)malloc(sizeof(BandRenderer));
+    if (br == NULL) {
+
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
+
+    threadCount = max_int32_2(threadCount, 1);
+    br->bandCount = min_int32_2(threadCount * BANDS_PER_THREAD,
+        max_int32_2(g->csize.y / MIN_BAND_HEIGHT, 1));
+
+    br->bands = (Graphics*)malloc(sizeof(Graphics) * br->bandCount);
+    if (br->bands == NULL) {
+
+        ERR_MEM_ALLOC;
+        free(br);
+        return NULL;
+    }
+
+    // The calling thread is one of the workers
+    br->pool = create_worker_pool(threadCount-1);
+    if (br->pool == NULL) {
+
+        free(br->bands);
+        free(br);
+        return NULL;
+    }
+
+    br->buf = NULL;
+    br->begin = 0;
+    br->end = 0;
+
+    return br;
+}
+
+
+// Dispose a band renderer
+void dispose_band_renderer(BandRenderer* br) {
+
+    if (br == NULL) return;
+
+    dispose_worker_pool(br->pool);
+    free(br->bands);
+    free(br);
+}
+
+
+// Draw the commands in the buffer
+void br_render(BandRenderer* br, Graphics* g, CommandBuffer* buf) {
+
+    int i, j;
+    uint32 offset, begin;
+    DirtyRects dirty;
+    SDL_Rect* r;
+    CommandHeader* h;
+    Graphics* first = &br->bands[0];
+
+    // Every band starts with the current state
+    // of the graphics, clipped to its own rows
+    for (i = 0; i < br->bandCount; ++ i) {
+
+        br->bands[i] = *g;
+        br->bands[i].cmdBuffer = NULL;
+        br->bands[i].dirty.count = 0;
+        br->bands[i].clipTop = g->csize.y * i / br->bandCount;
+        br->bands[i].clipBottom = g->csize.y * (i+1) / br->bandCount;
+    }
+    br->buf = buf;
+
+    // Draw the commands between barriers in parallel,
+    // and the barriers on the whole canvas
+    begin = 0;
+    for (offset = 0; offset < buf->size; offset += h->size) {
+
+        h = cmdbuf_get(buf, offset);
+        if (!is_barrier(h->type))
+            continue;
+
+        draw_commands(br, begin, offset);
+
+        // The first band starts from the top row,
+        // so only the bottom needs to be moved
+        first->clipBottom = g->csize.y;
+        g_execute_commands(first, buf, offset, offset + h->size);
+        first->clipBottom = g->csize.y / br->bandCount;
+
+        begin = offset + h->size;
+    }
+    draw_commands(br, begin, buf->size);
+
+    // Barriers do not change the state, so the
+    // bands end up in the same state. Store it
+    dirty = g->dirty;
+    *g = *first;
+    g->clipTop = 0;
+    g->clipBottom = g->csize.y;
+
+    // Collect the changed areas of all the bands
+    g->dirty = dirty;
+    for (i = 0; i < br->bandCount; ++ i) {
+
+        for (j = 0; j < br->bands[i].dirty.count; ++ j) {
+
+            r = &br->bands[i].dirty.rects[j];
+            g_mark_dirty(g, r->x, r->y, r->w, r->h);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+//
+// Band renderer. Replays recorded draw calls
+// on several threads, each thread drawing
+// its own horizontal band of the canvas
+// (c) 2019 Jani Nykänen
+//
+
+#ifndef __BAND_RENDERER__
+#define __BAND_RENDERER__
+
+#include "graphics.h"
+#include "workerpool.h"
+#include "cmdbuffer.h"
+
+// Band renderer type
+typedef struct {
+
+    // Workers
+    WorkerPool* pool;
+
+    // Band-local graphics, one per band
+    Graphics* bands;
+    int bandCount;
+
+    // Commands currently being drawn
+    CommandBuffer* buf;
+    uint32 begin;
+    uint32 end;
+
+} BandRenderer;
+
+// Create a band renderer that draws with
+// "threadCount" threads in total
+BandRenderer* create_band_renderer(Graphics* g, int threadCount);
+
+// Dispose a band renderer
+void dispose_band_renderer(BandRenderer* br);
+
+// Draw the commands in the buffer
+void br_render(BandRenderer* br, Graphics* g, CommandBuffer* buf);
+
+#endif // __BAND_RENDERER__
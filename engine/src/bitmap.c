@@ -5,7 +5,15 @@
 #include <stdio.h>
 
 #define STB_IMAGE_IMPLEMENTATION
+// The failure reason is a global that every load
+// writes to, which bitmaps loaded in parallel
+// would race on. It is not used anyway. The
+// function that sets it is then never called
+#define STBI_NO_FAILURE_STRINGS
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
 #include "lib/stb_image.h"
+#pragma GCC diagnostic pop
 
 // A reference to the renderer
 static SDL_Renderer* rendRef =NULL;
@@ -39,6 +47,7 @@ Bitmap* load_bitmap(const char* path, bool dither) {
     if (pdata == NULL) {
 
         err_throw_param_1("Failed to load a bitmap in ", path);
+        free(bmp);
         return NULL;
     }
     // Store dimensions
@@ -50,6 +59,7 @@ Bitmap* load_bitmap(const char* path, bool dither) {
     if (bmp->data == NULL) {
 
         ERR_MEM_ALLOC;
+        stbi_image_free(pdata);
         free(bmp);
         return NULL;
     }
@@ -130,6 +140,17 @@ Bitmap* load_bitmap(const char* path, bool dither) {
 
         bmp->data[i] = pixel;
     }
+    stbi_image_free(pdata);
+
+    // Generate runs
+    bmp->shared = false;
+    bmp->runs = NULL;
+    bmp->runRows = NULL;
+    if (bmp_gen_runs(bmp) == -1) {
+
+        destroy_bitmap(bmp);
+        return NULL;
+    }
 
     return bmp;
 }
@@ -159,15 +180,89 @@ Bitmap* create_bitmap(uint16 w, uint16 h) {
         return NULL;
     }
 
+    // No runs, the content is not known yet
+    bmp->runs = NULL;
+    bmp->runRows = NULL;
+    bmp->shared = false;
+
     return bmp;
 }
 
 
+// Generate opaque pixel runs
+int bmp_gen_runs(Bitmap* bmp) {
+
+    int x, y;
+    int start;
+    uint32 count = 0;
+    uint8* row;
+
+    // Count runs first
+    for (y = 0; y < bmp->height; ++ y) {
+
+        row = bmp->data + y*bmp->width;
+        for (x = 0; x < bmp->width; ++ x) {
+
+            if (row[x] != ALPHA && (x == 0 || row[x-1] == ALPHA))
+                ++ count;
+        }
+    }
+
+    // Allocate memory
+    free(bmp->runs);
+    free(bmp->runRows);
+    bmp->runs = (uint16*)malloc(sizeof(uint16) * 2 * (count > 0 ? count : 1));
+    bmp->runRows = (uint32*)malloc(sizeof(uint32) * (bmp->height+1));
+    if (bmp->runs == NULL || bmp->runRows == NULL) {
+
+        ERR_MEM_ALLOC;
+        free(bmp->runs);
+        free(bmp->runRows);
+        bmp->runs = NULL;
+        bmp->runRows = NULL;
+        return -1;
+    }
+
+    // Store runs
+    count = 0;
+    for (y = 0; y < bmp->height; ++ y) {
+
+        bmp->runRows[y] = count;
+
+        row = bmp->data + y*bmp->width;
+        for (x = 0; x < bmp->width; ) {
+
+            if (row[x] == ALPHA) {
+
+                ++ x;
+                continue;
+            }
+
+            start = x;
+            while (x < bmp->width && row[x] != ALPHA)
+                ++ x;
+
+            bmp->runs[count*2] = (uint16)start;
+            bmp->runs[count*2 +1] = (uint16)(x - start);
+            ++ count;
+        }
+    }
+    bmp->runRows[bmp->height] = count;
+
+    return 0;
+}
+
+
 // Destroy a bitmap
 void destroy_bitmap(Bitmap* bmp) {
 
     if (bmp == NULL) return;
 
-    free(bmp->data);
+    if (!bmp->shared) {
+
+        free(bmp->runs);
+        free(bmp->runRows);
+        free(bmp->data);
+    }
     free(bmp);
 }
@@ -26,6 +26,17 @@ typedef struct {
     uint16 width;
     uint16 height;
 
+    // Opaque pixel runs, stored as (start, length)
+    // pairs. NULL if not generated
+    uint16* runs;
+    // Index of the first run of each row,
+    // height+1 entries
+    uint32* runRows;
+
+    // The data is owned by an asset pack,
+    // only the bitmap itself is freed
+    bool shared;
+
 } Bitmap;
 
 // Initialize bitmap loader
@@ -37,6 +48,9 @@ Bitmap* load_bitmap(const char* path, bool dither);
 // Create a bitmap
 Bitmap* create_bitmap(uint16 w, uint16 h);
 
+// Generate opaque pixel runs
+int bmp_gen_runs(Bitmap* bmp);
+
 // Destroy a bitmap
 void destroy_bitmap(Bitmap* bmp);
 
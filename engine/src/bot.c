@@ -0,0 +1,106 @@
+#include "bot.h"
+
+#include "err.h"
+#include "mathext.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+// Chance to press a free key on an update, 1/n
+#define PRESS_CHANCE 12
+// Maximum time to hold a key, in updates
+#define MAX_HOLD_TIME 40
+
+
+// Add a key
+static void bot_add_key(Bot* b, int key) {
+
+    if (b->keyCount == BOT_MAX_KEYS) 
+        return;
+
+    b->hold[b->keyCount] = 0;
+    b->keys[b->keyCount ++] = key;
+}
+
+
+// Create a bot
+Bot* create_bot(Gamepad* vpad, uint32 seed) {
+
+    int i;
+
+    // Allocate memory
+    Bot* b = (Bot*)malloc(sizeof(Bot));
+    if (b == NULL) {
+
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
+
+    b->keyCount = 0;
+    // Zero would stay zero
+    b->state = seed == 0 ? 1 : seed;
+
+    // Stick
+    bot_add_key(b, (int)SDL_SCANCODE_LEFT);
+    bot_add_key(b, (int)SDL_SCANCODE_RIGHT);
+    bot_add_key(b, (int)SDL_SCANCODE_UP);
+    bot_add_key(b, (int)SDL_SCANCODE_DOWN);
+
+    // Buttons. Cancel is left out to not 
+    // leave the game every now and then
+    for (i = 0; i < vpad->buttonCount; ++ i) {
+
+        if (strcmp(vpad->buttons[i].name, "cancel") != 0)
+            bot_add_key(b, vpad->buttons[i].key);
+    }
+
+    return b;
+}
+
+
+// Dispose a bot
+void dispose_bot(Bot* b) {
+
+    if (b == NULL) return;
+
+    free(b);
+}
+
+
+// Update
+void bot_update(Bot* b, Input* input, 
+    void (*cb) (void* param, int key, bool down), void* param) {
+
+    int i;
+    bool down;
+
+    for (i = 0; i < b->keyCount; ++ i) {
+
+        // Release when the time is up
+        if (b->hold[i] > 0) {
+
+            if (-- b->hold[i] > 0) 
+                continue;
+
+            down = false;
+        }
+        else {
+
+            if (xorshift32(&b->state) % PRESS_CHANCE != 0)
+                continue;
+
+            b->hold[i] = 1 + xorshift32(&b->state) % MAX_HOLD_TIME;
+            down = true;
+        }
+
+        if (down)
+            event_key_down(input, b->keys[i]);
+        else
+            event_key_up(input, b->keys[i]);
+
+        if (cb != NULL)
+            cb(param, b->keys[i], down);
+    }
+}
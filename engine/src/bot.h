@@ -0,0 +1,45 @@
+//
+// Input bot for unattended runs
+// (c) 2019 Jani Nykänen
+//
+
+#ifndef __BOT__
+#define __BOT__
+
+#include "types.h"
+#include "input.h"
+#include "gamepad.h"
+
+#include <stdbool.h>
+
+#define BOT_MAX_KEYS 16
+
+// Bot type. Presses random keys and 
+// holds them for a random time
+typedef struct {
+
+    // Keys to press
+    int keys [BOT_MAX_KEYS];
+    int keyCount;
+    // Updates left to hold a key down,
+    // 0 if not pressed
+    int hold [BOT_MAX_KEYS];
+
+    // Random state
+    uint32 state;
+
+} Bot;
+
+// Create a bot that presses the keys of the 
+// gamepad buttons, except "cancel", and arrows
+Bot* create_bot(Gamepad* vpad, uint32 seed);
+
+// Dispose a bot
+void dispose_bot(Bot* b);
+
+// Update, passing the key events to the input
+// and to the given callback, if not NULL
+void bot_update(Bot* b, Input* input, 
+    void (*cb) (void* param, int key, bool down), void* param);
+
+#endif // __BOT__
@@ -0,0 +1,166 @@
+#include "cmdbuffer.h"
+
+#include "err.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Commands are aligned to this
+#define COMMAND_ALIGN 8
+
+
+// Create a command buffer
+CommandBuffer* create_command_buffer(uint32 capacity) {
+
+    // Allocate memory
+    CommandBuffer* buf = (CommandBuffer*)malloc(sizeof(CommandBuffer));
+    if (buf == NULL) {
+
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
+
+    capacity = capacity < COMMAND_ALIGN ? COMMAND_ALIGN : capacity;
+    buf->data = (uint8*)malloc(capacity);
+    if (buf->data == NULL) {
+
+        ERR_MEM_ALLOC;
+        free(buf);
+        return NULL;
+    }
+    buf->capacity = capacity;
+    cmdbuf_clear(buf);
+
+    return buf;
+}
+
+
+// Dispose a command buffer
+void dispose_command_buffer(CommandBuffer* buf) {
+
+    if (buf == NULL) return;
+
+    free(buf->data);
+    free(buf);
+}
+
+
+// Remove all the commands
+void cmdbuf_clear(CommandBuffer* buf) {
+
+    buf->size = 0;
+    buf->commandCount = 0;
+    buf->drawCount = 0;
+    memset(buf->typeCount, 0, sizeof(buf->typeCount));
+}
+
+
+// Add a command
+void* cmdbuf_push(CommandBuffer* buf, uint32 type, 
+    Bitmap* bmp, uint32 size) {
+
+    uint8* data;
+    uint32 capacity;
+    CommandHeader* h;
+    uint32 paramSize = size;
+
+    size = sizeof(CommandHeader) + size;
+    size = (size + COMMAND_ALIGN-1) & ~(COMMAND_ALIGN-1);
+
+    // Grow if not enough room
+    if (buf->size + size > buf->capacity) {
+
+        capacity = buf->capacity;
+        while (buf->size + size > capacity) {
+
+            capacity *= 2;
+        }
+
+        data = (uint8*)realloc(buf->data, capacity);
+        if (data == NULL) {
+
+            ERR_MEM_ALLOC;
+            return NULL;
+        }
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+
+    h = (CommandHeader*)(buf->data + buf->size);
+    h->type = type;
+    h->size = size;
+    h->bmp = bmp;
+
+    // Clear the alignment bytes, so the data 
+    // can be hashed
+    memset((uint8*)(h+1) + paramSize, 0, 
+        size - sizeof(CommandHeader) - paramSize);
+
+    buf->size += size;
+    ++ buf->commandCount;
+    ++ buf->typeCount[type];
+    if (type < FIRST_STATE_COMMAND)
+        ++ buf->drawCount;
+
+    return (void*)(h+1);
+}
+
+
+// Get the command at the given offset
+CommandHeader* cmdbuf_get(CommandBuffer* buf, uint32 offset) {
+
+    return (CommandHeader*)(buf->data + offset);
+}
+
+
+// Compute a hash of the commands
+uint32 cmdbuf_hash(CommandBuffer* buf) {
+
+    // FNV-1a
+    uint32 hash = 2166136261u;
+    uint32 i;
+
+    for (i = 0; i < buf->size; ++ i) {
+
+        hash ^= buf->data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+// Copy the commands of another buffer
+int cmdbuf_copy(CommandBuffer* dest, CommandBuffer* src) {
+
+    uint8* data;
+
+    // Grow if not enough room
+    if (src->size > dest->capacity) {
+
+        data = (uint8*)realloc(dest->data, src->capacity);
+        if (data == NULL) {
+
+            ERR_MEM_ALLOC;
+            return -1;
+        }
+        dest->data = data;
+        dest->capacity = src->capacity;
+    }
+
+    memcpy(dest->data, src->data, src->size);
+    dest->size = src->size;
+    dest->commandCount = src->commandCount;
+    dest->drawCount = src->drawCount;
+    memcpy(dest->typeCount, src->typeCount, sizeof(src->typeCount));
+
+    return 0;
+}
+
+
+// Check if two buffers have the same commands
+bool cmdbuf_equals(CommandBuffer* a, CommandBuffer* b) {
+
+    return a->size == b->size &&
+        memcmp(a->data, b->data, a->size) == 0;
+}
@@ -0,0 +1,171 @@
+//
+// Draw command buffer
+// (c) 2019 Jani Nykänen
+//
+
+#ifndef __CMD_BUFFER__
+#define __CMD_BUFFER__
+
+#include "types.h"
+#include "bitmap.h"
+
+#include <stdbool.h>
+
+// Command types
+enum {
+
+    CommandClearScreen = 0,
+    CommandDrawStatic = 1,
+    CommandBitmapRegion = 2,
+    CommandScaledBitmapRegion = 3,
+    CommandBitmapRegionFast = 4,
+    CommandWavingBitmap = 5,
+    CommandFillRect = 6,
+    CommandTriangle = 7,
+    CommandLine = 8,
+    Command3DFloor = 9,
+    CommandDarken = 10,
+    CommandCopyToBuffer = 11,
+    CommandZoomedRotated = 12,
+    CommandCircleOutside = 13,
+    CommandFreezeBackdrop = 14,
+    CommandBackdrop = 15,
+    CommandPixelFunction = 16,
+    CommandTranslate = 17,
+    CommandMoveTo = 18,
+    CommandUVCoords = 19,
+    CommandTexture = 20,
+    CommandDarknessColor = 21,
+
+    CommandTypeCount = 22,
+};
+
+// Commands starting from this one only
+// change the state, and do not draw
+#define FIRST_STATE_COMMAND CommandPixelFunction
+
+// Command header. The parameters follow
+// the header. They only have 4-byte members, 
+// so there are no padding bytes and the
+// commands can be compared as raw data
+typedef struct {
+
+    uint32 type;
+    // Size of the whole command, in bytes
+    uint32 size;
+    // Bitmap used by the command, if any
+    Bitmap* bmp;
+
+} CommandHeader;
+
+// Bitmap drawing parameters
+typedef struct {
+
+    int sx, sy, sw, sh;
+    int dx, dy, dw, dh;
+    int flip;
+
+} BitmapCommand;
+
+// Waving bitmap parameters
+typedef struct {
+
+    int x, y;
+    float wave;
+    int period;
+    float amplitude;
+
+} WaveCommand;
+
+// Shape parameters (rectangles, triangles, lines)
+typedef struct {
+
+    int x1, y1;
+    int x2, y2;
+    int x3, y3;
+    int col;
+
+} ShapeCommand;
+
+// Floor parameters
+typedef struct {
+
+    int x, y, w, h;
+    int xdelta;
+    int mx, my;
+
+} FloorCommand;
+
+// Zoomed & rotated bitmap parameters
+typedef struct {
+
+    float angle;
+    float sx, sy;
+
+} ZoomCommand;
+
+// Generic integer parameters
+typedef struct {
+
+    int param1;
+    int param2;
+    int param3;
+
+} IntCommand;
+
+// UV coordinate parameters
+typedef struct {
+
+    float u1, v1;
+    float u2, v2;
+    float u3, v3;
+
+} UVCommand;
+
+// Command buffer type
+typedef struct {
+
+    // Command data
+    uint8* data;
+    uint32 size;
+    uint32 capacity;
+
+    // Number of commands, in total and 
+    // by type, and the number of draw calls
+    int commandCount;
+    int typeCount [CommandTypeCount];
+    int drawCount;
+
+} CommandBuffer;
+
+// Create a command buffer
+CommandBuffer* create_command_buffer(uint32 capacity);
+
+// Dispose a command buffer
+void dispose_command_buffer(CommandBuffer* buf);
+
+// Remove all the commands
+void cmdbuf_clear(CommandBuffer* buf);
+
+// Add a command. Returns a pointer to the parameters
+// (valid until the next push), or NULL on error
+void* cmdbuf_push(CommandBuffer* buf, uint32 type, 
+    Bitmap* bmp, uint32 size);
+
+// Get the command at the given offset
+CommandHeader* cmdbuf_get(CommandBuffer* buf, uint32 offset);
+
+// Compute a hash of the commands. Two buffers
+// with the same commands have the same hash
+uint32 cmdbuf_hash(CommandBuffer* buf);
+
+// Copy the commands of another buffer
+int cmdbuf_copy(CommandBuffer* dest, CommandBuffer* src);
+
+// Check if two buffers have the same commands
+bool cmdbuf_equals(CommandBuffer* a, CommandBuffer* b);
+
+// Get command parameters
+#define CMD_PARAMS(h, type) ((type*)((h)+1))
+
+#endif // __CMD_BUFFER__
@@ -13,6 +13,7 @@ Config create_config() {
 
     Config c;
     c.paramCount = 0;
+    init_name_index(&c.index);
 
     return c;
 }
@@ -32,6 +33,8 @@ int conf_add_param(Config* c, const char* key, const char* value) {
     snprintf(kv.key, KVPAIR_KEY_LENGTH, "%s", key);
     snprintf(kv.value, KVPAIR_VALUE_LENGTH, "%s", value);
     c->params[c->paramCount] = kv;
+    nindex_add(&c->index, c->paramCount, 
+        c->params[0].key, sizeof(KeyValuePair));
 
     ++ c->paramCount;
 
@@ -42,14 +45,12 @@ int conf_add_param(Config* c, const char* key, const char* value) {
 // Get a param
 char* conf_get_param(Config *c, const char* key, const char* def) {
 
-    int i = 0;
-    for(; i < c->paramCount; ++ i) {
+    int i = nindex_find(&c->index, key, 
+        c->params[0].key, sizeof(KeyValuePair));
+    if (i < 0)
+        return (char*)def;
 
-        if (strcmp(c->params[i].key, key) == 0)
-            return c->params[i].value;
-    }
-
-    return (char*)def;
+    return c->params[i].value;
 }
 
 
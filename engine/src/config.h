@@ -8,6 +8,7 @@
 #define __CONFIG__
 
 #include "types.h"
+#include "nameindex.h"
 
 
 #define CONF_MAX_PARAM_COUNT 32
@@ -18,6 +19,8 @@ typedef struct {
 
     KeyValuePair params [CONF_MAX_PARAM_COUNT];
     int paramCount;
+    // Param indices by key
+    NameIndex index;
 
 } Config;
 
@@ -2,12 +2,21 @@
 
 #include "err.h"
 #include "mathext.h"
+#include "profiler.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 
 #include <SDL2/SDL_mixer.h>
 
+// Initial size of the draw command buffer
+#define CMD_BUFFER_SIZE 65536
+// Number of profiler samples kept
+#define PROFILER_SAMPLES 262144
+// Key that toggles the performance overlay
+#define PERF_OVERLAY_KEY SDL_SCANCODE_F3
+
 // Thread & mutex
 static SDL_Thread* thread;
 static SDL_mutex* mutex;
@@ -23,8 +32,12 @@ static int thread_load_assets(void* a) {
 
     AssetManager* assets = (AssetManager*)a;
 
-    result = assets_parse_text_file(assets, assets->assetPath);
+    int ret = assets_parse_text_file(assets, assets->assetPath);
+
+    SDL_LockMutex(mutex);
+    result = ret;
     loaded = true;
+    SDL_UnlockMutex(mutex);
 
     return 0;
 }
@@ -33,12 +46,30 @@ static int thread_load_assets(void* a) {
 // Draw loading screen
 static void core_draw_loading(Core* c, Graphics* g) {
 
+    const int BAR_HEIGHT = 4;
+    const int BAR_MARGIN = 8;
+    const uint8 BAR_COLOR = 255;
+
+    int w = g->csize.x / 2;
+    int x = g->csize.x/2 - w/2;
+    int y = g->csize.y/2 + BAR_MARGIN;
+
     g_clear_screen(g, 0);
 
     // Draw loading bitmap
-    g_draw_bitmap_fast(g, c->bmpLoading,
-        g->csize.x/2 - c->bmpLoading->width/2,
-        g->csize.y/2 - c->bmpLoading->height/2);
+    if (c->bmpLoading != NULL) {
+
+        g_draw_bitmap_fast(g, c->bmpLoading,
+            g->csize.x/2 - c->bmpLoading->width/2,
+            g->csize.y/2 - c->bmpLoading->height/2);
+        y += c->bmpLoading->height/2;
+    }
+
+    // Draw progress
+    g_fill_rect(g, x-1, y-1, w+2, BAR_HEIGHT+2, BAR_COLOR);
+    g_fill_rect(g, x, y, w, BAR_HEIGHT, 0);
+    g_fill_rect(g, x, y, 
+        (int)(w * assets_get_progress(c->assets)), BAR_HEIGHT, BAR_COLOR);
 }
 
 
@@ -46,23 +77,40 @@ static void core_draw_loading(Core* c, Graphics* g) {
 static int core_init_SDL(Core* c) {
 
     const int AUDIO_BUFFER_SIZE = 1024;
-    const int AUDIO_FREQ = 22050;
+
+    // Without a window, there might not be
+    // any display or audio device either
+    bool headless = conf_get_param_int(&c->conf, "headless", 0) == 1;
+    uint32 flags = SDL_INIT_EVERYTHING;
+    c->window = NULL;
+    if (headless) {
+
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+        flags = SDL_INIT_TIMER | SDL_INIT_AUDIO | SDL_INIT_EVENTS;
+    }
 
     // Initialize
-    if (SDL_Init(SDL_INIT_EVERYTHING) == -1) {
+    if (SDL_Init(flags) == -1) {
 
         err_throw_param_1("SDL2 ERROR: ", SDL_GetError());
         return -1;
     }
 
     // Initialize audio
-    if (Mix_OpenAudio(AUDIO_FREQ, MIX_DEFAULT_FORMAT, 2, AUDIO_BUFFER_SIZE) != 0 ||
+    if (Mix_OpenAudio(SAMPLE_FREQ, SAMPLE_FORMAT, 
+        SAMPLE_CHANNELS, AUDIO_BUFFER_SIZE) != 0 ||
         Mix_Init(0) != 0) {
 
         err_throw_param_1("Failed to initialize audio: %s", Mix_GetError());
         return -1;
     }
 
+    // Graphics are created without a window
+    if (headless) {
+
+        return 0;
+    }
+
     // Get window width and height
     int width = conf_get_param_int(&c->conf, "window_width", 640);
     int height = conf_get_param_int(&c->conf, "window_height", 480);
@@ -90,15 +138,85 @@ static int core_init_SDL(Core* c) {
 }
 
 
+// Start recording or playing the input,
+// and seed the random numbers
+static int core_init_replay(Core* c) {
+
+    c->seed = (uint32)time(NULL);
+
+    char* playPath = conf_get_param(&c->conf, "replay_play", NULL);
+    char* recordPath = conf_get_param(&c->conf, "replay_record", NULL);
+
+    if (playPath != NULL) {
+
+        c->replay = create_replay_player(playPath);
+        if (c->replay == NULL) {
+
+            return -1;
+        }
+        c->seed = c->replay->header.seed;
+    }
+    else if (recordPath != NULL) {
+
+        c->replay = create_replay_recorder(recordPath, 
+            c->seed, c->input.joyactive);
+        if (c->replay == NULL) {
+
+            return -1;
+        }
+    }
+    srand(c->seed);
+
+    return 0;
+}
+
+
+// Record an input event, if recording
+static void core_record(Core* c, int type, 
+    int index, float x, float y) {
+
+    if (c->replay != NULL && c->replay->mode == ReplayRecord)
+        replay_record(c->replay, type, index, x, y);
+}
+
+
+// Record a key event made by the bot
+static void core_record_bot(void* param, int key, bool down) {
+
+    core_record((Core*)param, 
+        down ? ReplayKeyDown : ReplayKeyUp, key, 0, 0);
+}
+
+
 // Initialize
 static int core_init(Core* c) {
 
+    c->cmdBuffer = NULL;
+    c->bandRenderer = NULL;
+    c->renderThread = NULL;
+    c->replay = NULL;
+    c->bot = NULL;
+    c->profilePath = NULL;
+    c->frameHash = 0;
+    c->prevFrame = NULL;
+    c->present = true;
+    c->droppedFrames = 0;
+    c->missedDeadlines = 0;
+
     // Initialize SDL2
     if (core_init_SDL(c) == -1) {
 
         return -1;
     }
 
+    // Profile, if there is a file to write to
+    c->profilePath = conf_get_param(&c->conf, "profile_trace", NULL);
+    if (c->profilePath != NULL && 
+        prof_init(PROFILER_SAMPLES) == -1) {
+
+        return -1;
+    }
+
     // Init global graphics context
     if (init_graphics_global() == 1) {
 
@@ -112,6 +230,48 @@ static int core_init(Core* c) {
         return -1;
     }
 
+    // The draw calls are recorded if skipping
+    // unchanged frames or drawing in bands. The
+    // render thread has buffers of its own
+    int renderThreads = conf_get_param_int(&c->conf, "render_threads", 1);
+    bool renderThread = 
+        conf_get_param_int(&c->conf, "render_thread", 0) == 1;
+    c->skipUnchanged = 
+        conf_get_param_int(&c->conf, "skip_unchanged_frames", 0) == 1;
+    if (!renderThread && (renderThreads > 1 || c->skipUnchanged)) {
+
+        c->cmdBuffer = create_command_buffer(CMD_BUFFER_SIZE);
+        if (c->cmdBuffer == NULL) {
+
+            return -1;
+        }
+    }
+    if (c->skipUnchanged) {
+
+        c->prevFrame = create_command_buffer(CMD_BUFFER_SIZE);
+        if (c->prevFrame == NULL) {
+
+            return -1;
+        }
+    }
+    if (renderThreads > 1) {
+
+        c->bandRenderer = create_band_renderer(c->g, renderThreads);
+        if (c->bandRenderer == NULL) {
+
+            return -1;
+        }
+    }
+    if (renderThread) {
+
+        c->renderThread = create_render_thread(c->g, 
+            c->bandRenderer, CMD_BUFFER_SIZE);
+        if (c->renderThread == NULL) {
+
+            return -1;
+        }
+    }
+
     // Fullscreen
     c->fullscreen = false;
     if (conf_get_param_int(&c->conf, "window_fullscreen", 0) == 1) {
@@ -143,9 +303,31 @@ static int core_init(Core* c) {
         }
     }
 
+    // Performance overlay
+    c->perf = create_perf_overlay();
+    c->perf.active = conf_get_param_int(&c->conf, "perf_overlay", 0) == 1;
+
     // Get framerate
     c->frameRate = max_int32_2(30, conf_get_param_int(&c->conf, "framerate", 30));
 
+    // Replay, the scenes may need random
+    // numbers already when initialized
+    if (core_init_replay(c) == -1) {
+
+        return -1;
+    }
+
+    // Bot, the recorded input is played instead
+    if (conf_get_param_int(&c->conf, "bot", 0) == 1 &&
+        (c->replay == NULL || c->replay->mode != ReplayPlay)) {
+
+        c->bot = create_bot(&c->vpad, c->seed);
+        if (c->bot == NULL) {
+
+            return -1;
+        }
+    }
+
     // Initialize scenes
     if (scenes_init(&c->sceneMan, (void*)&c->evMan) == -1) {
 
@@ -166,16 +348,41 @@ static int core_init(Core* c) {
 
         assets_set_path(c->assets, assetPath);
 
+        // Preconverted assets, the files are
+        // loaded instead if there are none
+        char* packPath = conf_get_param(&c->conf, "asset_pack", NULL);
+        if (packPath != NULL &&
+            assets_open_pack(c->assets, packPath) == -1) {
+
+            printf("Failed to open the asset pack: %s.\n Omitting...\n",
+                get_error());
+        }
+
+        // Threads used to load, one per core
+        // by default
+        int loadThreads = conf_get_param_int(&c->conf, "load_threads", 0);
+        assets_set_thread_count(c->assets, 
+            loadThreads > 0 ? loadThreads : SDL_GetCPUCount());
+
         ready = false;
         loaded = false;
 
+        // Create a mutex
+        mutex = SDL_CreateMutex();
+        if (mutex == NULL) {
+
+            err_throw_param_1("Failed to create a mutex: ", SDL_GetError());
+            return -1;
+        }
+
         // Start a thread
         thread = SDL_CreateThread(thread_load_assets, 
             "thread_load", (void*)c->assets);
+        if (thread == NULL) {
 
-        // Create a mutex
-        mutex = SDL_CreateMutex();
-            
+            err_throw_param_1("Failed to create a thread: ", SDL_GetError());
+            return -1;
+        }
     }
     else {
 
@@ -195,8 +402,25 @@ static void core_update(Core* c, uint32 delta) {
     // Time multiplier
     float tm = (((float)delta)/1000.0f) / (1.0f/60.0f);
 
+    // Pass the recorded input
+    if (c->replay != NULL && c->replay->mode == ReplayPlay &&
+        !replay_play_frame(c->replay, &c->input)) {
+
+        printf("Replay finished after %d frames.\n", 
+            (int)c->replay->frame);
+        dispose_replay(c->replay);
+        c->replay = NULL;
+    }
+    // Or the bot input
+    if (c->bot != NULL) {
+
+        bot_update(c->bot, &c->input, core_record_bot, (void*)c);
+    }
+
     // Update active scenes
+    Uint64 zone = prof_begin();
     scenes_update_active(&c->sceneMan, (void*)&c->evMan, tm);
+    prof_end("scenes_update_active", zone);
 
     // Update gamepad
     pad_update(&c->vpad);
@@ -205,16 +429,90 @@ static void core_update(Core* c, uint32 delta) {
 
     // Update transition
     tr_update(&c->tr, (void*)&c->evMan, tm);
+
+    if (c->replay != NULL)
+        replay_next_frame(c->replay);
 }
 
 
 // Draw
 static void core_draw(Core* c) {
 
+    uint32 hash;
+    Uint64 zone;
+    CommandBuffer* buf = c->cmdBuffer;
+
+    // Take the frame drawn by the render thread,
+    // and record the next one while it is shown
+    if (c->renderThread != NULL) {
+
+        zone = prof_begin();
+        rt_finish(c->renderThread, c->g);
+        prof_end("rt_finish", zone);
+
+        buf = rt_get_buffer(c->renderThread);
+    }
+
+    // Record the draw calls, if not drawn directly
+    if (buf != NULL) {
+
+        g_begin_recording(c->g, buf);
+    }
+
     // Draw active scenes
+    zone = prof_begin();
     scenes_draw_active(&c->sceneMan, c->g);
+    prof_end("scenes_draw_active", zone);
     // Draw transition
+    zone = prof_begin();
     tr_draw(&c->tr, c->g);
+    prof_end("tr_draw", zone);
+    // Draw performance overlay
+    perf_draw(&c->perf, c->g);
+
+    if (buf != NULL) {
+
+        g_end_recording(c->g);
+
+        // If the commands are the same as in the
+        // previous frame, so is the canvas. The
+        // frames are expected to draw everything
+        // again (or nothing), and static is random.
+        // The hash only rules out most changed
+        // frames, equal ones are compared in full
+        if (c->skipUnchanged) {
+
+            hash = cmdbuf_hash(buf);
+            if (hash == c->frameHash &&
+                buf->typeCount[CommandDrawStatic] == 0 &&
+                cmdbuf_equals(buf, c->prevFrame)) {
+
+                // The previous frame of the render 
+                // thread still needs to be shown
+                if (c->renderThread != NULL) 
+                    g_update_pixel_data(c->g);
+                return;
+            }
+            c->frameHash = hash;
+
+            // Without the commands, the next frame
+            // cannot be compared to this one
+            if (cmdbuf_copy(c->prevFrame, buf) == -1) {
+
+                c->frameHash = 0;
+                cmdbuf_clear(c->prevFrame);
+            }
+        }
+
+        zone = prof_begin();
+        if (c->renderThread != NULL)
+            rt_submit(c->renderThread);
+        else if (c->bandRenderer != NULL)
+            br_render(c->bandRenderer, c->g, buf);
+        else
+            g_draw_commands(c->g, buf);
+        prof_end("draw_commands", zone);
+    }
 
     // Update canvas
     g_update_pixel_data(c->g);
@@ -225,26 +523,50 @@ static void core_draw(Core* c) {
 static void core_events(Core* c) {
 
     SDL_Event e;
+    // When playing a replay, the input 
+    // from the devices is ignored
+    bool live = c->replay == NULL || c->replay->mode != ReplayPlay;
+
+    Uint64 zone = prof_begin();
+
     while(SDL_PollEvent(&e) != 0) {
 
+        // Toggle the performance overlay. Not
+        // passed to the game
+        if (e.type == SDL_KEYDOWN && e.key.repeat == 0 &&
+            e.key.keysym.scancode == PERF_OVERLAY_KEY) {
+
+            perf_toggle(&c->perf);
+            continue;
+        }
+
+        // Only the events not related to input
+        if (!live && e.type != SDL_QUIT && e.type != SDL_WINDOWEVENT)
+            continue;
+
         switch(e.type)
         {
         // Application quit
         case SDL_QUIT:
 
             core_terminate(c);
+            prof_end("core_events", zone);
             return;
 
         // Key down event
         case SDL_KEYDOWN:
 
             event_key_down(&c->input, (int)e.key.keysym.scancode);
+            core_record(c, ReplayKeyDown, 
+                (int)e.key.keysym.scancode, 0, 0);
             break;
 
         // Key up event
         case SDL_KEYUP:
 
             event_key_up(&c->input, (int)e.key.keysym.scancode);
+            core_record(c, ReplayKeyUp, 
+                (int)e.key.keysym.scancode, 0, 0);
             break;
 
         // Window event (resize etc)
@@ -255,18 +577,23 @@ static void core_events(Core* c) {
                         
                     g_resize(c->g, e.window.data1, e.window.data2);
             }
+            // The window contents may need to
+            // be shown again
+            c->present = true;
             break;
 
         // Joystick button pressed
         case SDL_JOYBUTTONDOWN:
 
             event_joy_down(&c->input, e.jbutton.button);
+            core_record(c, ReplayJoyDown, e.jbutton.button, 0, 0);
             break;
 
             // Joystick button released
             case SDL_JOYBUTTONUP:
 
                 event_joy_up(&c->input, e.jbutton.button);
+                core_record(c, ReplayJoyUp, e.jbutton.button, 0, 0);
                 break;
 
             // Joystick motion
@@ -283,6 +610,7 @@ static void core_events(Core* c) {
 
                     float value = (float)e.jaxis.value / 32767.0f;
                     event_joy_move(&c->input, value, axis);
+                    core_record(c, ReplayJoyMove, axis, value, 0);
             }
             break;
 
@@ -317,6 +645,7 @@ static void core_events(Core* c) {
 
                 // Joystick event
                 event_joy_move_axes(&c->input, stick.x, stick.y);
+                core_record(c, ReplayJoyMoveAxes, 0, stick.x, stick.y);
               
                 break;
             }
@@ -325,6 +654,73 @@ static void core_events(Core* c) {
             break;
         }
     }
+
+    prof_end("core_events", zone);
+}
+
+
+// Check if the assets are loaded, and
+// if so, call "on load"
+static int core_check_loaded(Core* c) {
+
+    SDL_LockMutex(mutex);
+    if (loaded) {
+
+        // The thread does not use the mutex
+        // any more, only returns
+        SDL_WaitThread(thread, NULL);
+        thread = NULL;
+
+        if (result == -1) {
+            
+            SDL_UnlockMutex(mutex);
+            return -1;
+        }
+
+        ready = true;
+        // Call "on load"
+        if (scenes_on_load(&c->sceneMan, c->assets) == -1) {
+
+            SDL_UnlockMutex(mutex);
+            return -1;
+        }
+
+        // The performance overlay uses the
+        // font of the game
+        c->perf.font = (Bitmap*)assets_get(c->assets, 
+            conf_get_param(&c->conf, "perf_overlay_font", "font"));
+    }
+    SDL_UnlockMutex(mutex);
+
+    return 0;
+}
+
+
+// Get the time since the given performance
+// counter value, in milliseconds
+static float core_get_time_since(Uint64 start) {
+
+    return (float)((double)(SDL_GetPerformanceCounter() - start) * 
+        1000.0 / (double)SDL_GetPerformanceFrequency());
+}
+
+
+// Wait until the given performance counter value.
+// Sleeps, so that the CPU is not kept busy
+static void core_wait_until(Uint64 time) {
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    uint32 ms;
+
+    if (now >= time) return;
+
+    // Less than a millisecond is not worth sleeping, 
+    // and the loop is run again soon enough
+    ms = (uint32)((time - now) * 1000 / SDL_GetPerformanceFrequency());
+    if (ms > 0) {
+
+        SDL_Delay(ms);
+    }
 }
 
 
@@ -332,84 +728,107 @@ static void core_events(Core* c) {
 static int core_loop(Core* c) {
 
     const int MAX_UPDATE_COUNT = 5;
-    const int COMPARED_FPS = 60;
+    // If this many updates behind, the time
+    // is given up instead of catching up
+    const int MAX_LAG = MAX_UPDATE_COUNT * 2;
 
-    // Get framerate for the game logic
-    int frameWait = 1000 / c->frameRate;
+    Uint64 freq = SDL_GetPerformanceFrequency();
 
-    // Time
-    int timeSum = 0;
-    uint32 oldTime = SDL_GetTicks();
-    uint32 newTime = oldTime;
+    // Time of one update. The game logic expects
+    // a whole number of milliseconds
+    int frameWait;
+    Uint64 period;
+    // Time of the next update
+    Uint64 next = SDL_GetPerformanceCounter();
+    Uint64 now;
+    Uint64 behind;
 
     int updateCount = 0;
     bool redraw = false;
+
+    // Performance
+    float updateTime = 0.0f;
+    float drawTime;
+    Uint64 start;
+
     while(c->running) {
 
         // Framerate may be changed run time
         frameWait = 1000 / c->frameRate;
+        period = freq * (Uint64)frameWait / 1000;
 
         // Update events
         core_events(c);
 
-        // Check time
-        oldTime = newTime;
-        newTime = SDL_GetTicks();
-        timeSum += (int)(newTime - oldTime);
+        // Update until the game time is 
+        // at the real time
+        now = SDL_GetPerformanceCounter();
         updateCount = 0;
+        start = now;
+        while (now >= next && updateCount < MAX_UPDATE_COUNT) {
+
+            // Missed if the next update is due already
+            if (now >= next + period) {
 
-        // Check if enough time passed
-        while(timeSum >= frameWait) {
+                ++ c->missedDeadlines;
+            }
 
             redraw = true;
 
             if (!ready) {
 
                 // Check if loaded
-                SDL_LockMutex(mutex);
-                if (loaded) {
+                if (core_check_loaded(c) == -1) {
 
-                    if (result == -1) {
-                        
-                        SDL_UnlockMutex(mutex);
-                        return -1;
-                    }
+                    return -1;
+                }
 
-                    ready = true;
-                    // Call "on load"
-                    if (scenes_on_load(&c->sceneMan, c->assets) == -1) {
+                // Loading the scenes takes time, 
+                // start the game from now
+                if (ready) {
 
-                        SDL_UnlockMutex(mutex);
-                        return -1;
-                    }
+                    now = SDL_GetPerformanceCounter();
+                    next = now;
                 }
-                SDL_UnlockMutex(mutex);
             }
             else {
 
                 // Update frame
                 core_update(c, frameWait);
-
             }
 
-            // Make sure we won't be updating the frame
-            // too many times
-            if (++ updateCount >= MAX_UPDATE_COUNT) {
+            next += period;
+            ++ updateCount;
+        }
+        if (updateCount > 0) {
 
-                timeSum = 0;
-                break;
-            }
+            updateTime = core_get_time_since(start);
+        }
 
-            // Reduce time sum
-            timeSum -= frameWait; 
+        // Too far behind, give up the time
+        if (now >= next + period * MAX_LAG) {
+
+            behind = (now - next) / period;
+            c->droppedFrames += (uint32)behind;
+            next += behind * period;
         }
 
+        // Draw & present only if there is
+        // something new to show
         if (redraw) {
 
             if (ready) {
 
                 // Draw
+                start = SDL_GetPerformanceCounter();
                 core_draw(c);
+                drawTime = core_get_time_since(start);
+
+                // Only one of the updates is seen
+                c->droppedFrames += updateCount - 1;
+                perf_add_frame(&c->perf, updateTime, drawTime,
+                    updateCount, c->droppedFrames, c->missedDeadlines,
+                    (float)frameWait);
             }
             else {
 
@@ -420,12 +839,79 @@ static int core_loop(Core* c) {
             }
 
             redraw = false;
+            c->present = true;
+        }
+        if (c->present) {
+
+            // Refresh frame (and draw the canvas)
+            g_refresh(c->g);
+            c->present = false;
+        }
+
+        // Sleep until the next update
+        core_wait_until(next);
+    }
+
+    return 0;
+}
+
+
+// Simulation loop. Updates the given number of
+// frames as fast as possible, not bound to time
+static int core_simulate(Core* c, int frames) {
+
+    const double MINUTE = 60000.0;
+
+    // Draw every n updates, 0 for never
+    int drawInterval = conf_get_param_int(&c->conf, 
+        "simulate_draw_interval", 0);
+
+    int frame = 0;
+    int frameWait;
+    double gameTime = 0.0;
+    uint32 startTime;
+    double elapsed;
+
+    // Wait for the assets
+    while (!ready) {
+
+        if (core_check_loaded(c) == -1) {
+
+            return -1;
         }
+        SDL_Delay(1);
+    }
+
+    startTime = SDL_GetTicks();
+    for (; frame < frames; ++ frame) {
+
+        // Quit events still stop the simulation
+        core_events(c);
+        if (!c->running) break;
+
+        // Framerate may be changed run time
+        frameWait = 1000 / c->frameRate;
+        core_update(c, frameWait);
+        gameTime += (double)frameWait;
+
+        // The bot (or the replay of one) may choose
+        // to quit in a menu, but that is no reason
+        // to stop before the given frame count
+        c->running = true;
+
+        if (drawInterval > 0 && (frame+1) % drawInterval == 0) {
 
-        // Refresh frame (and draw the canvas)
-        g_refresh(c->g);
+            core_draw(c);
+            g_refresh(c->g);
+        }
     }
 
+    elapsed = (double)(SDL_GetTicks() - startTime) / 1000.0;
+    printf("Simulated %d frames (%.1f game minutes) in %.2f s, "
+        "%.0f updates per second.\n",
+        frame, gameTime / MINUTE, elapsed, 
+        (double)frame / (elapsed > 0.001 ? elapsed : 0.001));
+
     return 0;
 }
 
@@ -433,28 +919,60 @@ static int core_loop(Core* c) {
 // Destroy
 static void core_destroy(Core* c) {
 
+    // The last frame may still be drawn, so
+    // stop the drawing threads before anything
+    // they use is destroyed
+    dispose_render_thread(c->renderThread);
+    dispose_band_renderer(c->bandRenderer);
+
+    // The assets cannot be destroyed 
+    // while they are being loaded
+    if (thread != NULL) {
+
+        SDL_WaitThread(thread, NULL);
+        thread = NULL;
+    }
+
+    // Write the profiler samples, now that
+    // no other thread can add them
+    if (c->profilePath != NULL) {
+
+        if (prof_write_chrome_trace(c->profilePath) == -1) {
+
+            printf("Failed to write the profile: %s\n", get_error());
+        }
+        prof_dispose();
+    }
+
     // Destroy global data
     destroy_global_graphics();
 
     // Destroy components
+    dispose_replay(c->replay);
+    dispose_bot(c->bot);
     assets_dispose(c->assets);
+    dispose_command_buffer(c->cmdBuffer);
+    dispose_command_buffer(c->prevFrame);
     dispose_graphics(c->g);
 
     // Dispose scenes
     scenes_dispose(&c->sceneMan, (void*)&c->evMan);
 
     // Destroy window
-    SDL_DestroyWindow(c->window);
+    if (c->window != NULL)
+        SDL_DestroyWindow(c->window);
 }
 
 
 // Run
 void core_run(Core* c) {
 
-    // Initialize & start the main loop
+    // Initialize & start the main loop, or 
+    // simulate a fixed number of frames
     char buf[1024];
+    int frames = conf_get_param_int(&c->conf, "simulate_frames", 0);
     if (core_init(c) == -1 ||
-        core_loop(c) == -1) {
+        (frames > 0 ? core_simulate(c, frames) : core_loop(c)) == -1) {
 
         snprintf(buf, 1024, "%s", get_error());
         printf("Fatal error: %s.\n", buf);
@@ -470,6 +988,8 @@ void core_run(Core* c) {
 // Toggle fullscreen
 void core_toggle_fullscreen(Core* c) {
 
+    if (c->window == NULL) return;
+
     c->fullscreen = !c->fullscreen;
 /* 
     #ifdef __MINGW32__
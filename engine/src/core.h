@@ -15,6 +15,12 @@
 #include "assets.h"
 #include "transition.h"
 #include "audioplayer.h"
+#include "cmdbuffer.h"
+#include "bandrenderer.h"
+#include "renderthread.h"
+#include "replay.h"
+#include "bot.h"
+#include "perfoverlay.h"
 
 #include <SDL2/SDL.h>
 
@@ -44,6 +50,14 @@ typedef struct {
     bool fullscreen;
     // Framerate
     int frameRate;
+    // Is there a frame to present
+    bool present;
+
+    // Frames that were updated but never drawn
+    uint32 droppedFrames;
+    // Updates that were done late, when the
+    // next one was already due
+    uint32 missedDeadlines;
 
     // Old window size & position
     // (not needed now)
@@ -53,6 +67,38 @@ typedef struct {
     // Loading bitmap
     Bitmap* bmpLoading;
 
+    // Performance overlay
+    PerfOverlay perf;
+
+    // Recorded draw calls, NULL if the frames
+    // are drawn directly
+    CommandBuffer* cmdBuffer;
+    // Renderer that draws the commands in bands,
+    // NULL if not enabled
+    BandRenderer* bandRenderer;
+    // Thread that draws the commands of a frame
+    // while the next one is updated, NULL if
+    // the frames are drawn on the main thread
+    RenderThread* renderThread;
+    // Skip frames with the same commands as 
+    // the previous one, which are kept in
+    // prevFrame (NULL if not skipping)
+    bool skipUnchanged;
+    uint32 frameHash;
+    CommandBuffer* prevFrame;
+
+    // Input recording or replay, NULL if
+    // the input comes from the devices only
+    Replay* replay;
+    // Bot that plays instead of the user,
+    // NULL if not enabled
+    Bot* bot;
+    // Random seed
+    uint32 seed;
+    // File to write the profiler samples to,
+    // NULL if not profiling
+    const char* profilePath;
+
 } Core;
 
 // Run
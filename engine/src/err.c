@@ -3,10 +3,15 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include <SDL2/SDL.h>
+
 // Error buffer
 static char errBuffer [ERR_MAX_LENGTH];
 // Does an error exist
 static bool hasError =false;
+// Errors may be thrown by several
+// loading threads at once
+static SDL_SpinLock errLock = 0;
 
 
 // Initialize error handling
@@ -19,13 +24,17 @@ void err_init() {
 // Throw an error
 void err_throw_no_param(const char* msg) {
 
+    SDL_AtomicLock(&errLock);
     snprintf(errBuffer, ERR_MAX_LENGTH, "%s", msg);
     hasError = true;
+    SDL_AtomicUnlock(&errLock);
 }
 void err_throw_param_1(const char* msg, const char* param) {
 
+    SDL_AtomicLock(&errLock);
     snprintf(errBuffer, ERR_MAX_LENGTH, "%s%s", msg, param);
     hasError = true;
+    SDL_AtomicUnlock(&errLock);
 }
 
 
@@ -33,8 +42,10 @@ void err_throw_param_1(const char* msg, const char* param) {
 // if does not exist
 char* get_error() {
 
+    SDL_AtomicLock(&errLock);
     char* ret = hasError ? errBuffer : NULL;
     hasError = false;
+    SDL_AtomicUnlock(&errLock);
 
     return ret;
 }
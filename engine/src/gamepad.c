@@ -11,6 +11,7 @@ Gamepad create_gamepad(Input* inputRef) {
 
     vpad.input = inputRef;
     vpad.buttonCount = 0;
+    init_name_index(&vpad.index);
 
     vpad.stick = vec2(0, 0);
     vpad.delta = vec2(0, 0);
@@ -35,7 +36,10 @@ int pad_add_button(Gamepad* vpad,
     b.key = key;
     b.joybutton = joybutton;
 
-    vpad->buttons[vpad->buttonCount ++] = b;
+    vpad->buttons[vpad->buttonCount] = b;
+    nindex_add(&vpad->index, vpad->buttonCount, 
+        vpad->buttons[0].name, sizeof(Button));
+    ++ vpad->buttonCount;
 
     return 0;
 }
@@ -44,20 +48,26 @@ int pad_add_button(Gamepad* vpad,
 // Get button state
 State pad_get_button_state(Gamepad* vpad, const char* bname) {
     
-    // Find a button
-    int i = 0;
-    Button* b = NULL;
-    for(; i < vpad->buttonCount; ++ i) {
+    return pad_get_button_state_by_handle(vpad, 
+        pad_get_button_handle(vpad, bname));
+}
 
-        if (strcmp(bname, vpad->buttons[i].name) == 0) {
 
-            b = &vpad->buttons[i];
-            break;
-        }
-    }
-    if (b == NULL)
+// Get a handle to a button
+int pad_get_button_handle(Gamepad* vpad, const char* bname) {
+
+    return nindex_find(&vpad->index, bname, 
+        vpad->buttons[0].name, sizeof(Button));
+}
+
+
+// Get button state by a button handle
+State pad_get_button_state_by_handle(Gamepad* vpad, int handle) {
+
+    if (handle < 0 || handle >= vpad->buttonCount)
         return StateUp;
 
+    Button* b = &vpad->buttons[handle];
 
     // Check keyboard first, then joystick
     State s = input_get_key_state(vpad->input, b->key);
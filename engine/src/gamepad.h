@@ -9,6 +9,7 @@
 
 #include "input.h"
 #include "types.h"
+#include "nameindex.h"
 
 #define MAX_BUTTON_COUNT 16
 #define MAX_BUTTON_NAME_LENGTH 16
@@ -31,6 +32,8 @@ typedef struct {
     // Values
     Button buttons [MAX_BUTTON_COUNT];
     int buttonCount;
+    // Button indices by name
+    NameIndex index;
     Vector2 stick;
     Vector2 delta;
 
@@ -45,6 +48,14 @@ int pad_add_button(Gamepad* vpad,
 // Get button state
 State pad_get_button_state(Gamepad* vpad, const char* bname);
 
+// Get a handle to a button, -1 if there is no
+// such button. Handles stay the same, so they 
+// can be found once and then kept
+int pad_get_button_handle(Gamepad* vpad, const char* bname);
+
+// Get button state by a button handle
+State pad_get_button_state_by_handle(Gamepad* vpad, int handle);
+
 // Update
 void pad_update(Gamepad* vpad);
 
@@ -3,11 +3,22 @@
 #include "bitmap.h"
 #include "err.h"
 #include "mathext.h"
+#include "profiler.h"
 
 #include <math.h>
 
+// Vector instructions for the sprite blitter
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 // Maximum value for darkness & light effects
 #define MAX_PALETTE_MOD 8
+// Length of the buffer used for a row of
+// scaled pixels
+#define LINE_BUFFER_LENGTH 256
 
 // Global darkness & light palettes (aaaand red)
 static uint8** dpalette;
@@ -17,6 +28,16 @@ static uint8** redPalette;
 static uint8 ditherArray [MAX_PALETTE_MOD*2] [2];
 
 
+// If recording, store the command
+// instead of drawing
+#define RECORD_COMMAND(g, type, bmp, T, ...) \
+    if (g->cmdBuffer != NULL) { \
+        T* cmd = (T*)cmdbuf_push(g->cmdBuffer, type, bmp, sizeof(T)); \
+        if (cmd != NULL) *cmd = (T){__VA_ARGS__}; \
+        return; \
+    }
+
+
 //
 // Pixel functions
 //
@@ -113,34 +134,294 @@ static void pfunc_lighten(void* _g, int offset, uint8 c) {
     g->pdata[offset] 
          = lpalette[ ditherArray[g->pparam1] [ x % 2 == y % 2] ] [col];
 }
-static void pfunc_texture(void* _g, int offset, uint8 col) {
+//
+// Span functions
+//
+// Blitters pick one of these once per draw call
+// instead of calling a pixel function for every
+// pixel. The position dependent stuff (parity and
+// the skip modulo) is carried along the span, so no
+// divisions are needed per pixel.
+//
 
-    Graphics* g = (Graphics*)_g;
+// Span state
+typedef struct {
 
-    int x = offset % g->csize.x;
-    int y = offset / g->csize.x;
+    // Is x % 2 == y % 2
+    int parity;
+    // x % pparam1
+    int xmod;
+    // Is y % pparam1 == 0
+    bool skipRow;
+    // Dithered palettes for both parities
+    uint8* lut [2];
 
-    int dx = x - g->top.x;
-    int dy = y - g->top.y;
+} SpanState;
 
-    Point t = point(dx, dy);
+// Span function types. "Blit" skips alpha pixels,
+// "copy" does not. The source pointer is moved by
+// "dir" after every pixel, so dir = 0 can be used
+// to fill a span with a single color
+typedef void (*SpanFunction) (Graphics* g, uint8* out,
+    const uint8* src, int dir, int len, int x, int y);
 
-    // Get texture coordinates
-    t = mat2_fixed_mul(g->uvTransf, t);
 
-    t.x += g->uvTrans.x;
-    t.y += g->uvTrans.y;
+// Initialize span state
+static void init_span_state(Graphics* g, SpanState* s,
+    uint8** palette, int x, int y) {
 
-    // Limit the coordinates inside the _BITMAP
-    t.x = neg_mod(t.x, g->tex->width);
-    t.y = neg_mod(t.y, g->tex->height);
+    s->parity = (x & 1) == (y & 1);
+    s->xmod = 0;
+    s->skipRow = false;
+    if (g->pparam1 > 0) {
 
-    col = g->tex->data[t.y * g->tex->width + t.x];
-    if (col != ALPHA)
-        g->pdata[offset] = col;
+        s->xmod = x % g->pparam1;
+        s->skipRow = y % g->pparam1 == 0;
+    }
+
+    if (palette != NULL) {
+
+        s->lut[0] = palette[ditherArray[g->pparam1] [0] ];
+        s->lut[1] = palette[ditherArray[g->pparam1] [1] ];
+    }
+}
+
+
+// Move to the next pixel in a span
+#define NEXT_SPAN_PIXEL(g, s) { \
+    s.parity ^= 1; \
+    if (++ s.xmod == g->pparam1) s.xmod = 0; \
+}
+
+// Is the current pixel skipped by the skip functions
+#define SPAN_SKIPPED(s) (s.skipRow || s.xmod == 0)
+
+
+// Generate blit & copy span functions for
+// a pixel operation
+#define SPAN_FUNCTIONS(name, palette, PIXEL) \
+static void span_blit_##name(Graphics* g, uint8* out, \
+    const uint8* src, int dir, int len, int x, int y) { \
+    \
+    SpanState s; \
+    init_span_state(g, &s, palette, x, y); \
+    for (; len > 0; -- len) { \
+        \
+        if (*src != ALPHA) { PIXEL; } \
+        src += dir; \
+        ++ out; \
+        NEXT_SPAN_PIXEL(g, s); \
+    } \
+} \
+static void span_copy_##name(Graphics* g, uint8* out, \
+    const uint8* src, int dir, int len, int x, int y) { \
+    \
+    SpanState s; \
+    init_span_state(g, &s, palette, x, y); \
+    for (; len > 0; -- len) { \
+        \
+        PIXEL; \
+        src += dir; \
+        ++ out; \
+        NEXT_SPAN_PIXEL(g, s); \
+    } \
 }
 
 
+// Blit 16 pixels at once, skipping alpha pixels.
+// If flipped, the source pointer points to the last
+// byte of the block. Return false if not supported
+#if defined(__SSE2__)
+static bool blit_block_16(uint8* out, const uint8* src, bool flip) {
+
+    const __m128i alpha = _mm_set1_epi8((char)ALPHA);
+
+    __m128i s, d, mask;
+    int bits;
+
+    if (!flip) {
+
+        s = _mm_loadu_si128((const __m128i*)src);
+    }
+    else {
+
+        // Reverse the byte order: swap bytes in words,
+        // then reverse the words
+        s = _mm_loadu_si128((const __m128i*)(src-15));
+        s = _mm_or_si128(_mm_slli_epi16(s, 8), _mm_srli_epi16(s, 8));
+        s = _mm_shufflelo_epi16(s, _MM_SHUFFLE(0, 1, 2, 3));
+        s = _mm_shufflehi_epi16(s, _MM_SHUFFLE(0, 1, 2, 3));
+        s = _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2));
+    }
+
+    mask = _mm_cmpeq_epi8(s, alpha);
+    bits = _mm_movemask_epi8(mask);
+
+    // Fully transparent
+    if (bits == 0xFFFF)
+        return true;
+
+    // Fully opaque
+    if (bits == 0) {
+
+        _mm_storeu_si128((__m128i*)out, s);
+        return true;
+    }
+
+    d = _mm_loadu_si128((const __m128i*)out);
+    d = _mm_or_si128(_mm_and_si128(mask, d), _mm_andnot_si128(mask, s));
+    _mm_storeu_si128((__m128i*)out, d);
+
+    return true;
+}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+static bool blit_block_16(uint8* out, const uint8* src, bool flip) {
+
+    uint8x16_t s, d, mask;
+
+    if (!flip) {
+
+        s = vld1q_u8(src);
+    }
+    else {
+
+        s = vrev64q_u8(vld1q_u8(src-15));
+        s = vcombine_u8(vget_high_u8(s), vget_low_u8(s));
+    }
+
+    mask = vceqq_u8(s, vdupq_n_u8(ALPHA));
+    d = vld1q_u8(out);
+    vst1q_u8(out, vbslq_u8(mask, d, s));
+
+    return true;
+}
+#else
+static bool blit_block_16(uint8* out, const uint8* src, bool flip) {
+
+    return false;
+}
+#endif
+
+
+// Default span functions, no state needed
+static void span_blit_default(Graphics* g, uint8* out,
+    const uint8* src, int dir, int len, int x, int y) {
+
+    uint8 col;
+
+    // Vector path, 16 pixels at a time
+    if (dir == 1 || dir == -1) {
+
+        for (; len >= 16; len -= 16) {
+
+            if (!blit_block_16(out, src, dir == -1))
+                break;
+
+            src += dir*16;
+            out += 16;
+        }
+    }
+
+    // Scalar path for the rest
+    for (; len > 0; -- len) {
+
+        col = *src;
+        if (col != ALPHA)
+            *out = col;
+
+        src += dir;
+        ++ out;
+    }
+}
+static void span_copy_default(Graphics* g, uint8* out,
+    const uint8* src, int dir, int len, int x, int y) {
+
+    if (dir == 0) {
+
+        memset(out, *src, len);
+        return;
+    }
+    else if (dir == 1) {
+
+        memcpy(out, src, len);
+        return;
+    }
+
+    for (; len > 0; -- len) {
+
+        *(out ++) = *src;
+        src += dir;
+    }
+}
+// For the opaque pixel runs of bitmaps. There are
+// no alpha pixels, so the vector path of the sprite
+// blitter copies long runs 16 pixels at a time
+static void span_copy_opaque(Graphics* g, uint8* out,
+    const uint8* src, int dir, int len, int x, int y) {
+
+    for (; len >= 16; len -= 16) {
+
+        if (!blit_block_16(out, src, dir == -1))
+            break;
+
+        src += dir*16;
+        out += 16;
+    }
+    span_copy_default(g, out, src, dir, len, x, y);
+}
+
+SPAN_FUNCTIONS(darken, dpalette,
+    *out = s.lut[s.parity][*out])
+SPAN_FUNCTIONS(single_color, NULL,
+    *out = (uint8)g->pparam1)
+SPAN_FUNCTIONS(skip_single_color, NULL,
+    if (!SPAN_SKIPPED(s)) *out = (uint8)g->pparam2)
+SPAN_FUNCTIONS(inverse_frame, NULL,
+    *out = ~(*out))
+SPAN_FUNCTIONS(inverse, NULL,
+    *out = ~(*src))
+SPAN_FUNCTIONS(skip_inverse, NULL,
+    if (!SPAN_SKIPPED(s)) *out = ~(*out))
+SPAN_FUNCTIONS(skip, NULL,
+    if (!SPAN_SKIPPED(s)) *out = *src)
+SPAN_FUNCTIONS(skip_simple, NULL,
+    if (s.parity) *out = *src)
+SPAN_FUNCTIONS(skip_simple_single_color, NULL,
+    if (s.parity) *out = (uint8)g->pparam2)
+SPAN_FUNCTIONS(lighten, lpalette,
+    *out = s.lut[s.parity][*out])
+
+// Span functions, indexed by the pixel function type
+static const SpanFunction spanBlitFuncs[] = {
+
+    span_blit_default,
+    span_blit_darken,
+    span_blit_single_color,
+    span_blit_skip_single_color,
+    span_blit_inverse_frame,
+    span_blit_inverse,
+    span_blit_skip_inverse,
+    span_blit_skip,
+    span_blit_skip_simple,
+    span_blit_skip_simple_single_color,
+    span_blit_lighten,
+};
+static const SpanFunction spanCopyFuncs[] = {
+
+    span_copy_default,
+    span_copy_darken,
+    span_copy_single_color,
+    span_copy_skip_single_color,
+    span_copy_inverse_frame,
+    span_copy_inverse,
+    span_copy_skip_inverse,
+    span_copy_skip,
+    span_copy_skip_simple,
+    span_copy_skip_simple_single_color,
+    span_copy_lighten,
+};
+
+
 // Generate texturing matrices etc.
 static void gen_uv_transf(Graphics* g, Bitmap* tex,
     int x1, int y1, int x2, int y2, int x3, int y3) {
@@ -360,15 +641,15 @@ static bool clip_rect(Graphics* g, int* x, int* y,
     }
 
     // Top
-    if(*y < 0) {
+    if(*y < g->clipTop) {
 
-        *h -= 0 - (*y);
-        *y = 0;
+        *h -= g->clipTop - (*y);
+        *y = g->clipTop;
     }
     // Bottom
-    if(*y+*h >= g->csize.y) {
+    if(*y+*h >= g->clipBottom) {
 
-        *h -= (*y+*h) - (0 + g->csize.y);
+        *h -= (*y+*h) - g->clipBottom;
     }
 
     return *w > 0 && *h > 0;
@@ -401,23 +682,82 @@ static bool clip(Graphics* g, int* sx, int* sy, int* sw, int* sh,
 
     // Top
     oh = *sh;
-    if(*dy < 0) {
+    if(*dy < g->clipTop) {
 
-        *sh -= 0 - (*dy);
+        *sh -= g->clipTop - (*dy);
         *sy += oh-*sh;
-        *dy = 0;
+        *dy = g->clipTop;
     }
     // Bottom
-    if(*dy+*sh >= g->csize.y) {
+    if(*dy+*sh >= g->clipBottom) {
 
-        *sh -= (*dy+*sh) - (0 + g->csize.y);
+        *sh -= (*dy+*sh) - g->clipBottom;
     }
 
     return *sw > 0 && *sh > 0;
 }
 
 
-// Draw half a triangle
+// Draw a textured span. The texture coordinates are
+// stepped along the span instead of computing them
+// again for every pixel
+static void draw_textured_span(Graphics* g, uint8* out, 
+    int x, int len, int y) {
+
+    Bitmap* tex = g->tex;
+    int w = tex->width;
+    int h = tex->height;
+    int u, v;
+    uint8 col;
+
+    // Fixed point texture coordinates, relative to the
+    // top point, before dividing by the precision
+    int dx = x - g->top.x;
+    int dy = y - g->top.y;
+    int tu = g->uvTransf.m11 * dx + g->uvTransf.m21 * dy;
+    int tv = g->uvTransf.m12 * dx + g->uvTransf.m22 * dy;
+    int du = g->uvTransf.m11;
+    int dv = g->uvTransf.m12;
+
+    // Power of two textures can be wrapped with a mask
+    if ((w & (w-1)) == 0 && (h & (h-1)) == 0) {
+
+        for (; len > 0; -- len) {
+
+            u = (tu / FIXED_PREC + g->uvTrans.x) & (w-1);
+            v = (tv / FIXED_PREC + g->uvTrans.y) & (h-1);
+
+            col = tex->data[v*w + u];
+            if (col != ALPHA)
+                *out = col;
+
+            ++ out;
+            tu += du;
+            tv += dv;
+        }
+        return;
+    }
+
+    for (; len > 0; -- len) {
+
+        u = (tu / FIXED_PREC + g->uvTrans.x) % w;
+        v = (tv / FIXED_PREC + g->uvTrans.y) % h;
+        if (u < 0) u += w;
+        if (v < 0) v += h;
+
+        col = tex->data[v*w + u];
+        if (col != ALPHA)
+            *out = col;
+
+        ++ out;
+        tu += du;
+        tv += dv;
+    }
+}
+
+
+// Draw half a triangle. Every row is clipped once
+// and drawn as a span
 static void draw_triangle_half(Graphics * g,
     int midx, int midy, int endMid, int endy, 
     int stepx, int stepy, int dx, int dend, 
@@ -426,36 +766,71 @@ static void draw_triangle_half(Graphics * g,
     int sx = midx * FIXED_PREC;
     int ex = endMid * FIXED_PREC;
 
-    int x, y;
-    uint64 offset;
+    int y;
+    int start, end;
+    int skip;
+    uint8* out;
+    SpanFunction fill = spanCopyFuncs[g->pmode];
 
-    int signx = stepx > 0 ? 1 : -1;
-    int signy = stepy > 0 ? 1 : -1;
+    // Area actually drawn
+    int minx = g->csize.x, maxx = -1;
+    int miny = g->csize.y, maxy = -1;
 
-    int endx;
+    // Skip the rows outside the clipping area at once
+    skip = 0;
+    if (stepy > 0) {
 
-    // Draw horizontal lines
-    for (y = midy; y*signy <= endy*signy; y += stepy) {
+        skip = max_int32_2(g->clipTop - midy, 0);
+        endy = min_int32_2(endy, g->clipBottom-1);
+    }
+    else {
+
+        skip = max_int32_2(midy - (g->clipBottom-1), 0);
+        endy = max_int32_2(endy, g->clipTop);
+    }
+    sx += dx * skip;
+    ex -= dend * skip;
 
-        x = sx / FIXED_PREC;
-        offset = y * g->csize.x + x;
+    // Draw horizontal lines
+    for (y = midy + stepy*skip; y*stepy <= endy*stepy; y += stepy) {
 
-        endx = ex / FIXED_PREC;
-        for (; x*signx <= endx*signx; x += stepx) {
+        // The span goes from the middle line to the
+        // end line, both ends included
+        start = sx / FIXED_PREC;
+        end = ex / FIXED_PREC;
+        if (stepx < 0) {
 
-            // Check if inside the canvas
-            if (x >= 0 
-                && x < g->csize.x 
-                && y >= 0 
-                && y < g->csize.y) {
-                
-                g->pfunc(g, offset, col);
-            }
-            offset += stepx;
+            start = end;
+            end = sx / FIXED_PREC;
         }
 
         sx += dx;
         ex -= dend;
+
+        // Clip
+        start = max_int32_2(start, 0);
+        end = min_int32_2(end, g->csize.x-1);
+        if (start > end) 
+            continue;
+
+        minx = min_int32_2(minx, start);
+        maxx = max_int32_2(maxx, end);
+        miny = min_int32_2(miny, y);
+        maxy = max_int32_2(maxy, y);
+
+        out = g->pdata + y*g->csize.x;
+
+        if (g->tex != NULL) {
+
+            draw_textured_span(g, out + start, start, end-start+1, y);
+            continue;
+        }
+        fill(g, out + start, &col, 0, end-start+1, start, y);
+    }
+
+    if (maxx >= 0) {
+
+        g_mark_dirty(g, minx, miny, maxx-minx+1, maxy-miny+1);
     }
 }
 
@@ -469,6 +844,7 @@ int init_graphics_global() {
         return 1;
     }
     gen_dither_array();
+    init_trig_tables();
 
     return 0;
 }
@@ -504,34 +880,41 @@ Graphics* create_graphics(SDL_Window* window, Config* conf) {
 
     // Store window, just for sure
     g->window = window;
-
-    // Create a renderer
-    g->rend = SDL_CreateRenderer(window, -1,
-            SDL_RENDERER_ACCELERATED  |
-            SDL_RENDERER_PRESENTVSYNC |
-            SDL_RENDERER_TARGETTEXTURE);
-    if (g->rend == NULL) {
-
-        err_throw_no_param("Failed to create a renderer.");
-        return NULL;
-    }
+    g->headless = window == NULL || 
+        conf_get_param_int(conf, "headless", 0) == 1;
+    g->rend = NULL;
+    g->canvas = NULL;
 
     // Read view target size
     g->csize.x = conf_get_param_int(conf, "canvas_width", 256);
     g->csize.y = conf_get_param_int(conf, "canvas_height", 192);
     g->aspectRatio = (float)g->csize.x / (float)g->csize.y;
 
-    // Create the canvas texture
-    g->canvas = 
-        SDL_CreateTexture(g->rend, 
-        SDL_PIXELFORMAT_RGB332, 
-        SDL_TEXTUREACCESS_STREAMING, 
-        g->csize.x, 
-        g->csize.y);
-    if (g->canvas == NULL) {
+    if (!g->headless) {
 
-        err_throw_param_1("Failed to create a texture: ", SDL_GetError());
-        return NULL;
+        // Create a renderer
+        g->rend = SDL_CreateRenderer(window, -1,
+                SDL_RENDERER_ACCELERATED  |
+                SDL_RENDERER_PRESENTVSYNC |
+                SDL_RENDERER_TARGETTEXTURE);
+        if (g->rend == NULL) {
+
+            err_throw_no_param("Failed to create a renderer.");
+            return NULL;
+        }
+
+        // Create the canvas texture
+        g->canvas = 
+            SDL_CreateTexture(g->rend, 
+            SDL_PIXELFORMAT_RGB332, 
+            SDL_TEXTUREACCESS_STREAMING, 
+            g->csize.x, 
+            g->csize.y);
+        if (g->canvas == NULL) {
+
+            err_throw_param_1("Failed to create a texture: ", SDL_GetError());
+            return NULL;
+        }
     }
 
     // Create canvas data
@@ -554,18 +937,59 @@ Graphics* create_graphics(SDL_Window* window, Config* conf) {
     g->bufferCopy.width = g->csize.x;
     g->bufferCopy.height = g->csize.y;
     g->bufferCopy.data = g->pbuffer;
+    g->bufferCopy.runs = NULL;
+    g->bufferCopy.runRows = NULL;
+
+    // Create backdrop
+    g->pbackdrop = (uint8*)calloc(g->csize.x*g->csize.y, sizeof(uint8));
+    if (g->pbackdrop == NULL) {
+
+        free(g->pbuffer);
+        free(g->pdata);
+        free(g);
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
 
-    // Resize
-    int w, h;
-    SDL_GetWindowSize(window, &w, &h);
+    // Create floor tables, built when needed
+    g->floor = (FloorTable*)calloc(1, sizeof(FloorTable));
+    if (g->floor == NULL) {
+
+        free(g->pbackdrop);
+        free(g->pbuffer);
+        free(g->pdata);
+        free(g);
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
+
+    // Resize, headless canvas is "shown" 
+    // in its own size
+    int w = g->csize.x;
+    int h = g->csize.y;
+    if (!g->headless) {
+
+        SDL_GetWindowSize(window, &w, &h);
+    }
     g_resize(g, w, h);
 
     // Set defaults
     g->translation = point(0, 0);
+    g->clipTop = 0;
+    g->clipBottom = g->csize.y;
+    g->cmdBuffer = NULL;
+    g->dirty.count = 0;
+    g_mark_dirty(g, 0, 0, g->csize.x, g->csize.y);
+    g->noise = 1;
     g->dvalue = 0;
     g->pfunc = pfunc_default;
+    g->pmode = PixelFunctionDefault;
     g->pparam1 = 0;
+    g->pparam2 = 0;
     g->tex = NULL;
+    g->uv1 = vec2(0, 0);
+    g->uv2 = vec2(0, 0);
+    g->uv3 = vec2(0, 0);
     g->darray = dpalette;
 
     return g;
@@ -577,9 +1001,16 @@ void dispose_graphics(Graphics* g) {
 
     if (g == NULL) return;
 
-    SDL_DestroyRenderer(g->rend);
-    SDL_DestroyTexture(g->canvas);
+    if (!g->headless) {
+
+        SDL_DestroyRenderer(g->rend);
+        SDL_DestroyTexture(g->canvas);
+    }
 
+    free(g->floor->rows);
+    free(g->floor->columns);
+    free(g->floor);
+    free(g->pbackdrop);
     free(g->pbuffer);
     free(g->pdata);
     free(g);
@@ -617,6 +1048,9 @@ void g_resize(Graphics* g, int w, int h) {
 // Set pixel function
 void g_set_pixel_function(Graphics* g, int func, int param1, int param2) {
 
+    RECORD_COMMAND(g, CommandPixelFunction, NULL, IntCommand, 
+        func, param1, param2);
+
     // TODO: An array approach
     switch (func)
     {
@@ -665,8 +1099,9 @@ void g_set_pixel_function(Graphics* g, int func, int param1, int param2) {
         break;
     
     default:
-        break;
+        return;
     }
+    g->pmode = func;
     g->pparam1 = param1;
     g->pparam2 = param2;
 }
@@ -675,6 +1110,8 @@ void g_set_pixel_function(Graphics* g, int func, int param1, int param2) {
 // Translate
 void g_translate(Graphics* g, int tx, int ty) {
 
+    RECORD_COMMAND(g, CommandTranslate, NULL, IntCommand, tx, ty);
+
     g->translation.x += tx;
     g->translation.y += ty;
 }
@@ -683,21 +1120,118 @@ void g_translate(Graphics* g, int tx, int ty) {
 // Move to
 void g_move_to(Graphics* g, int dx, int dy) {
 
+    RECORD_COMMAND(g, CommandMoveTo, NULL, IntCommand, dx, dy);
+
     g->translation.x = dx;
     g->translation.y = dy;
 }
 
 
-// Pass data to the canvas
+// Get the area of the union of two rectangles
+static int union_area(SDL_Rect* a, SDL_Rect* b) {
+
+    int w = max_int32_2(a->x + a->w, b->x + b->w) - min_int32_2(a->x, b->x);
+    int h = max_int32_2(a->y + a->h, b->y + b->h) - min_int32_2(a->y, b->y);
+
+    return w*h;
+}
+
+
+// Make a rectangle the union of two rectangles
+static void unite_rects(SDL_Rect* a, SDL_Rect* b) {
+
+    int x = min_int32_2(a->x, b->x);
+    int y = min_int32_2(a->y, b->y);
+
+    a->w = max_int32_2(a->x + a->w, b->x + b->w) - x;
+    a->h = max_int32_2(a->y + a->h, b->y + b->h) - y;
+    a->x = x;
+    a->y = y;
+}
+
+
+// Mark an area of the canvas changed
+void g_mark_dirty(Graphics* g, int x, int y, int w, int h) {
+
+    int i;
+    int cost, bestCost;
+    int best;
+    DirtyRects* d = &g->dirty;
+    SDL_Rect r;
+
+    // Clip
+    if (!clip_rect(g, &x, &y, &w, &h))
+        return;
+    r = (SDL_Rect){x, y, w, h};
+
+    // Merge with the rectangles it overlaps, or is
+    // near enough to not make the union much larger
+    // than the two separately. The union may now
+    // overlap others, so check them all again
+    for (i = 0; i < d->count; ++ i) {
+
+        if (union_area(&d->rects[i], &r) > 
+            d->rects[i].w*d->rects[i].h + r.w*r.h)
+            continue;
+
+        unite_rects(&r, &d->rects[i]);
+        d->rects[i] = d->rects[-- d->count];
+        i = -1;
+    }
+
+    if (d->count < MAX_DIRTY_RECTS) {
+
+        d->rects[d->count ++] = r;
+        return;
+    }
+
+    // No room, merge with the one that grows least
+    best = 0;
+    bestCost = 0;
+    for (i = 0; i < d->count; ++ i) {
+
+        cost = union_area(&d->rects[i], &r) - d->rects[i].w*d->rects[i].h;
+        if (i == 0 || cost < bestCost) {
+
+            best = i;
+            bestCost = cost;
+        }
+    }
+    unite_rects(&d->rects[best], &r);
+}
+
+
+// Pass the changed areas to the canvas
 void g_update_pixel_data(Graphics* g) {
+
+    int i;
+    SDL_Rect* r;
+
+    if (g->headless) {
+
+        g->dirty.count = 0;
+        return;
+    }
     
-    SDL_UpdateTexture(g->canvas, NULL, g->pdata, g->csize.x);
+    Uint64 zone = prof_begin();
+    for (i = 0; i < g->dirty.count; ++ i) {
+
+        r = &g->dirty.rects[i];
+        SDL_UpdateTexture(g->canvas, r, 
+            g->pdata + r->y*g->csize.x + r->x, g->csize.x);
+    }
+    g->dirty.count = 0;
+    prof_end("g_update_pixel_data", zone);
 }
 
 
 // Refresh
 void g_refresh(Graphics* g) {
 
+    if (g->headless) return;
+
+    Uint64 zone = prof_begin();
+
     // Clear background
     SDL_SetRenderDrawColor(g->rend, 0, 0, 0, 255);
     SDL_RenderClear(g->rend);
@@ -712,14 +1246,20 @@ void g_refresh(Graphics* g) {
 
     // Render the g->pdata
     SDL_RenderPresent(g->rend);
+
+    prof_end("g_refresh", zone);
 }
 
 
 // Clear screen
 void g_clear_screen(Graphics* g, uint8 c) {
 
-    int32 i = 0;
-    for(; i < g->csize.x*g->csize.y; ++ i) {
+    RECORD_COMMAND(g, CommandClearScreen, NULL, IntCommand, c);
+
+    g_mark_dirty(g, 0, 0, g->csize.x, g->csize.y);
+
+    int32 i = g->clipTop*g->csize.x;
+    for(; i < g->clipBottom*g->csize.x; ++ i) {
 
         g->pdata[i] = c;
     }
@@ -729,10 +1269,17 @@ void g_clear_screen(Graphics* g, uint8 c) {
 // Draw some static
 void g_draw_static(Graphics* g) {
 
-    int32 i = 0;
-    for(; i < g->csize.x*g->csize.y; ++ i) {
+    RECORD_COMMAND(g, CommandDrawStatic, NULL, IntCommand, 0);
+
+    g_mark_dirty(g, 0, 0, g->csize.x, g->csize.y);
 
-        g->pdata[i] = (rand() % 2 == 0) ? 255 : 0;
+    // Every band gets different noise
+    uint32 state = (xorshift32(&g->noise) ^ ((uint32)g->clipTop << 16)) | 1;
+
+    int32 i = g->clipTop*g->csize.x;
+    for(; i < g->clipBottom*g->csize.x; ++ i) {
+
+        g->pdata[i] = (xorshift32(&state) & 1) ? 255 : 0;
     }
 }
 
@@ -748,17 +1295,70 @@ void g_draw_bitmap(Graphics* g, Bitmap* bmp,
 }
 
 
+// Draw a clipped bitmap region using the opaque
+// pixel runs, so alpha pixels need not to be checked
+static void draw_bitmap_region_runs(Graphics* g, Bitmap* bmp, 
+    int sx, int sy, int sw, int sh, 
+    int dx, int dy, bool flip) {
+
+    int y;
+    uint32 i, end;
+    int start, stop;
+    uint8* out;
+    const uint8* src;
+    SpanFunction copy = g->pmode == PixelFunctionDefault ?
+        span_copy_opaque : spanCopyFuncs[g->pmode];
+
+    out = g->pdata + g->csize.x*dy;
+    src = bmp->data + bmp->width*sy;
+    for (y = dy; y < dy+sh; ++ y) {
+
+        end = bmp->runRows[sy + y-dy +1];
+        for (i = bmp->runRows[sy + y-dy]; i < end; ++ i) {
+
+            // Clip the run to the source area
+            start = bmp->runs[i*2];
+            if (start >= sx+sw) 
+                break;
+            stop = start + bmp->runs[i*2 +1];
+            if (stop <= sx) 
+                continue;
+
+            start = max_int32_2(start, sx);
+            stop = min_int32_2(stop, sx+sw);
+
+            if (!flip) {
+
+                copy(g, out + dx + (start-sx), src + start, 
+                    1, stop-start, dx + (start-sx), y);
+            }
+            else {
+
+                copy(g, out + dx + (sx+sw-stop), src + stop-1, 
+                    -1, stop-start, dx + (sx+sw-stop), y);
+            }
+        }
+
+        src += bmp->width;
+        out += g->csize.x;
+    }
+}
+
+
 // Draw a bitmap region
 void g_draw_bitmap_region(Graphics* g, Bitmap* bmp, 
     int sx, int sy, int sw, int sh, 
     int dx, int dy,
     bool flip) {
 
-    int x, y;
-    int offset;
-    int boff;
-    int pixel;
+    int y;
+    uint8* out;
+    const uint8* src;
     int dir = flip ? -1 : 1;
+    SpanFunction blit;
+
+    RECORD_COMMAND(g, CommandBitmapRegion, bmp, BitmapCommand,
+        sx, sy, sw, sh, dx, dy, 0, 0, flip);
 
     if (bmp == NULL) return;
 
@@ -791,27 +1391,25 @@ void g_draw_bitmap_region(Graphics* g, Bitmap* bmp,
     // Clip
     if(!clip(g, &sx, &sy, &sw, &sh, &dx, &dy, flip))
         return;
+    g_mark_dirty(g, dx, dy, sw, sh);
 
-    // Draw pixels
-    offset = g->csize.x*dy + dx;
-    boff = bmp->width*sy + sx + (flip ? (sw-1) : 0);
-    for(y = 0; y < sh; ++ y) {
+    // If opaque runs exist, use them instead
+    if (bmp->runs != NULL) {
 
-        for(x = 0; x < sw; ++ x) {
+        draw_bitmap_region_runs(g, bmp, sx, sy, sw, sh, dx, dy, flip);
+        return;
+    }
 
-            pixel = bmp->data[boff];
-            // Check if not alpha pixel
-            // (i.e not transparent)
-            if (pixel != ALPHA) {
+    // Draw pixels, row by row
+    blit = spanBlitFuncs[g->pmode];
+    out = g->pdata + g->csize.x*dy + dx;
+    src = bmp->data + bmp->width*sy + sx + (flip ? (sw-1) : 0);
+    for(y = dy; y < dy+sh; ++ y) {
 
-                g->pfunc(g, offset, pixel);
-            }
+        blit(g, out, src, dir, sw, dx, y);
 
-            boff += dir;
-            ++ offset;
-        }
-        boff += bmp->width-sw*dir;
-        offset += g->csize.x-sw;
+        src += bmp->width;
+        out += g->csize.x;
     }
 }
 
@@ -830,11 +1428,11 @@ void g_draw_scaled_bitmap_region(Graphics* g, Bitmap* bmp,
     //
 
     int x, y;
-    int offset;
-    int boff;
-    int pixel;
     int dir = flip ? -1 : 1;
 
+    RECORD_COMMAND(g, CommandScaledBitmapRegion, bmp, BitmapCommand,
+        sx, sy, sw, sh, dx, dy, dw, dh, flip);
+
     if (bmp == NULL || dw <= 0 || dh <= 0) return;
 
     // Translate
@@ -842,46 +1440,59 @@ void g_draw_scaled_bitmap_region(Graphics* g, Bitmap* bmp,
     dy += g->translation.y;
 
     // If outside the screen, do not draw
-    if (dx+dw < 0 || dy+dh < 0 ||
-        dx >= g->csize.x || dy >= g->csize.y  )
+    if (dx+dw < 0 || dy+dh < g->clipTop ||
+        dx >= g->csize.x || dy >= g->clipBottom)
         return;
 
     int tx, ty;
-    uint8 col;
+    int startx, starty, endx, endy;
+    int stx;
+    int len;
+    const uint8* row;
+    uint8 line [LINE_BUFFER_LENGTH];
+    SpanFunction blit = spanBlitFuncs[g->pmode];
 
     // Jumps
     int xjump = sw * FIXED_PREC / dw;
     int yjump = sh * FIXED_PREC / dh;
 
-    // Draw pixels
+    // Clip
     ty = sy * FIXED_PREC;
-    for(y = dy; y < min_int32_2(dy+dh, g->csize.y); ++ y) {
+    stx = (flip ? sx+sw-1 : sx) * FIXED_PREC;
+    starty = dy;
+    if (starty < g->clipTop) {
 
-        if (y < 0) {
+        ty += yjump * (g->clipTop - starty);
+        starty = g->clipTop;
+    }
+    startx = dx;
+    if (startx < 0) {
 
-            ty += yjump * -y;
-            y = 0;
-        }
+        stx += dir * xjump * -startx;
+        startx = 0;
+    }
+    endy = min_int32_2(dy+dh, g->clipBottom);
+    endx = min_int32_2(dx+dw, g->csize.x);
+    g_mark_dirty(g, startx, starty, endx-startx, endy-starty);
 
-        tx = (flip ? sx+sw-1 : sx) * FIXED_PREC;
-        for(x = dx; x < min_int32_2(dx+dw, g->csize.x); ++ x) {
+    // Draw pixels. Each row is sampled to a buffer
+    // first, and then passed to the span function
+    for(y = starty; y < endy; ++ y) {
 
-            if (x < 0) {
+        row = bmp->data + 
+            min_int32_2(round_fixed(ty, FIXED_PREC), bmp->height-1)*bmp->width;
 
-                tx += dir * xjump * -x;
-                x = 0;
-            }
+        tx = stx;
+        for (x = startx; x < endx; x += len) {
 
-            col = bmp->data[ 
-                min_int32_2(round_fixed(ty, FIXED_PREC), bmp->height-1)*bmp->width  +
-                min_int32_2(round_fixed(tx, FIXED_PREC), bmp->width-1) ];
-            
-            if (col != ALPHA) {
+            len = min_int32_2(endx-x, LINE_BUFFER_LENGTH);
+            for (int i = 0; i < len; ++ i) {
 
-                g->pfunc(g, y*g->csize.x+x, col);
+                line[i] = row[min_int32_2(round_fixed(tx, FIXED_PREC), 
+                    bmp->width-1)];
+                tx += xjump * dir;
             }
-
-            tx += xjump * dir;
+            blit(g, g->pdata + y*g->csize.x + x, line, 1, len, x, y);
         }
 
         ty += yjump;
@@ -909,6 +1520,9 @@ void g_draw_bitmap_region_fast(Graphics* g, Bitmap* bmp,
     int boff;
     int pixel;
 
+    RECORD_COMMAND(g, CommandBitmapRegionFast, bmp, BitmapCommand,
+        sx, sy, sw, sh, dx, dy);
+
     if (bmp == NULL) return;
 
     // Translate
@@ -918,6 +1532,7 @@ void g_draw_bitmap_region_fast(Graphics* g, Bitmap* bmp,
     // Clip
     if (!clip(g, &sx, &sy, &sw, &sh, &dx, &dy, false))
         return;
+    g_mark_dirty(g, dx, dy, sw, sh);
 
     // Draw pixels
     offset = g->csize.x*dy + dx;
@@ -940,22 +1555,53 @@ void g_draw_waving_bitmap(Graphics* g, Bitmap* bmp,
     // TODO: Proper clipping
     //
 
+    RECORD_COMMAND(g, CommandWavingBitmap, bmp, WaveCommand,
+        dx, dy, wave, period, amplitude);
+
     int sx = 0;
     int sy = 0;
     int sw = bmp->width;
     int sh = bmp->height;
-
-    // Clip
-    if(!clip(g, &sx, &sy, &sw, &sh, &dx, &dy, false))
+    int top = g->clipTop;
+    int bottom = g->clipBottom;
+    bool visible;
+
+    // Clip to the whole canvas, so the wave
+    // does not depend on the clipping rows
+    g->clipTop = 0;
+    g->clipBottom = g->csize.y;
+    visible = clip(g, &sx, &sy, &sw, &sh, &dx, &dy, false);
+    g->clipTop = top;
+    g->clipBottom = bottom;
+    if (!visible)
         return;
+
+    // Pixels can be moved to the neighbouring rows,
+    // so a few rows outside the clipping area are
+    // drawn, and only the pixels inside it are kept
+    int margin = (int)fabsf(amplitude) / g->csize.x + 1;
+    int starty = max_int32_2(top - margin - dy, 0);
+    int endy = min_int32_2(bottom + margin - dy, sh);
+    int minOffset = top * g->csize.x;
+    int maxOffset = bottom * g->csize.x;
+
+    // Whole rows are marked, since pixels 
+    // can move to the next row
+    g_mark_dirty(g, 0, dy + starty - margin, 
+        g->csize.x, endy - starty + margin*2);
     
     // Draw pixels
-    int offset = g->csize.x*dy + dx;
+    int offset = g->csize.x*(dy+starty) + dx;
     int jump;
-    int boff = bmp->width*sy + sx;
+    int boff = bmp->width*(sy+starty) + sx;
     uint8 pixel;
     int x, y;
-    for(y = 0; y < sh; ++ y) {
+    for(y = starty; y < endy; ++ y) {
+
+        // The whole row moves by the same amount
+        jump = (int)(fast_sin( 
+            (M_PI * 2.0f)/period * (y % period) + wave) * 
+            amplitude);
 
         for(x = 0; x < sw; ++ x) {
 
@@ -964,11 +1610,8 @@ void g_draw_waving_bitmap(Graphics* g, Bitmap* bmp,
             // (i.e not transparent)
             if (pixel != ALPHA) {
 
-                jump = (int)(sinf( 
-                    (M_PI * 2.0f)/period * (y % period) + wave) * 
-                    amplitude);
-    
-                g->pfunc(g, offset + jump, pixel);
+                if (offset + jump >= minOffset && offset + jump < maxOffset)
+                    g->pfunc(g, offset + jump, pixel);
             }
 
             ++ boff;
@@ -1030,8 +1673,12 @@ void g_draw_text(Graphics* g, Bitmap* bmp, const char* text,
 void g_fill_rect(Graphics* g, int dx, int dy, 
     int dw, int dh, uint8 col) {
 
-    int x, y;
-    uint64 offset;
+    int y;
+    uint8* out;
+    SpanFunction fill;
+
+    RECORD_COMMAND(g, CommandFillRect, NULL, ShapeCommand,
+        dx, dy, dw, dh, 0, 0, col);
 
     dx += g->translation.x;
     dy += g->translation.y;
@@ -1039,16 +1686,15 @@ void g_fill_rect(Graphics* g, int dx, int dy,
     // Clip
     if (!clip_rect(g, &dx, &dy, &dw, &dh))
         return;
+    g_mark_dirty(g, dx, dy, dw, dh);
 
     // Draw
-    offset = g->csize.x*dy + dx;
+    fill = spanCopyFuncs[g->pmode];
+    out = g->pdata + g->csize.x*dy + dx;
     for (y = dy; y < dy+dh; ++ y) {
 
-        for (x = dx; x < dx+dw; ++ x) {
-
-            g->pfunc(g, offset ++, col);
-        }
-        offset += g->csize.x-dw;
+        fill(g, out, &col, 0, dw, dx, y);
+        out += g->csize.x;
     }
 }
 
@@ -1060,6 +1706,9 @@ void g_draw_triangle(Graphics* g,
     int x3, int y3, 
     uint8 col) {
 
+    RECORD_COMMAND(g, CommandTriangle, NULL, ShapeCommand,
+        x1, y1, x2, y2, x3, y3, col);
+
     // If points are in the same line, do not draw
     if ( abs((x3-x1)*(y3-y1)-(x2-x1)*(y2-y1)) == 0 ) {
 
@@ -1094,9 +1743,6 @@ void g_draw_triangle(Graphics* g,
         // Generate uv transform matrix
         gen_uv_transf(g, g->tex, 
             x1, y1, x2, y2, x3, y3);
-
-        // Use the texturing function now
-        g->pfunc = pfunc_texture; 
     }
 
     // Calculate horizontal step(s)
@@ -1150,6 +1796,7 @@ void g_draw_triangle(Graphics* g,
     if (g->tex != NULL) {
 
         g->pfunc = pfunc_default;
+        g->pmode = PixelFunctionDefault;
     }
 }
 
@@ -1158,6 +1805,12 @@ void g_draw_triangle(Graphics* g,
 void g_draw_line(Graphics* g, int x1, int y1, 
     int x2, int y2, uint8 col) {
 
+    RECORD_COMMAND(g, CommandLine, NULL, ShapeCommand,
+        x1, y1, x2, y2, 0, 0, col);
+
+    g_mark_dirty(g, min_int32_2(x1, x2), min_int32_2(y1, y2),
+        abs(x2-x1) + 1, abs(y2-y1) + 1);
+
     // Bresenham's line algorithm
     int dx = abs(x2-x1), sx = x1<x2 ? 1 : -1;
     int dy = abs(y2-y1), sy = y1<y2 ? 1 : -1; 
@@ -1165,7 +1818,8 @@ void g_draw_line(Graphics* g, int x1, int y1,
      
     while(true) {
 
-        if (!(y1 >= g->csize.y-1 || y1 < 0 ||
+        if (!(y1 >= g->csize.y-1 || 
+            y1 < g->clipTop || y1 >= g->clipBottom ||
             x1 >= g->csize.x-1 || x1 < 0 )) {
 
             g->pdata[y1 * g->csize.x + x1] = col;
@@ -1189,10 +1843,10 @@ void g_draw_line(Graphics* g, int x1, int y1,
 void g_draw_thick_line(Graphics* g, 
     int dx1, int dy1, int dx2, int dy2, int r, uint8 col) {
 
-    float angle = atan2f(dy2-dy1, dx2-dx1) + M_PI/2.0f;
+    float angle = fast_atan2(dy2-dy1, dx2-dx1) + M_PI/2.0f;
 
-    float c = cosf(angle);
-    float s = sinf(angle);
+    float c = fast_cos(angle);
+    float s = fast_sin(angle);
 
     int x1 = dx1-(int)(c*r/2);
     int y1 = dy1-(int)(s*r/2);
@@ -1211,21 +1865,36 @@ void g_draw_thick_line(Graphics* g,
 } 
 
 
-// Draw "3D" floor
-void g_draw_3D_floor(Graphics* g, Bitmap* bmp,
-    int dx, int dy, int w, int h, int xdelta,
-    int mx, int my) {
+// Build floor tables, if not built for 
+// these parameters already
+static int build_floor_table(FloorTable* t, Bitmap* bmp,
+    int w, int h, int mx, int my) {
 
     int x, y;
     int tx, ty;
     int px, py;
-    uint8 col;
+    uint32* rows;
+    uint16* columns;
 
-    // Translate
-    dx += g->translation.x;
-    dy += g->translation.y;
-    w -= g->translation.x;
-    h -= g->translation.y;
+    if (t->bmp == bmp && t->w == w && t->h == h && 
+        t->mx == mx && t->my == my)
+        return 0;
+
+    // Allocate memory
+    rows = (uint32*)realloc(t->rows, sizeof(uint32) * h);
+    if (rows == NULL) {
+
+        ERR_MEM_ALLOC;
+        return -1;
+    }
+    t->rows = rows;
+    columns = (uint16*)realloc(t->columns, sizeof(uint16) * w*h);
+    if (columns == NULL) {
+
+        ERR_MEM_ALLOC;
+        return -1;
+    }
+    t->columns = columns;
 
     int yjumpDelta = (int)mx / h;
     int yjump = FIXED_PREC;
@@ -1234,16 +1903,18 @@ void g_draw_3D_floor(Graphics* g, Bitmap* bmp,
     int xjump = (int)my;
 
     ty = 0;
-    for (y = dy; y < dy + h; ++ y) {
+    for (y = 0; y < h; ++ y) {
 
         py = round_fixed(ty, FIXED_PREC) % bmp->height;
+        if (py < 0) py += bmp->height;
+        rows[y] = py * bmp->width;
+
         tx = -w/2 * yjump;
-        for (x = dx; x < dx + w; ++ x) {
+        for (x = 0; x < w; ++ x) {
             
-            px = neg_mod((round_fixed(tx, FIXED_PREC))-xdelta, bmp->width);
-            col = bmp->data[py * bmp->width + px];
-
-            g->pdata[y*g->csize.x + x] = col;
+            px = round_fixed(tx, FIXED_PREC) % bmp->width;
+            if (px < 0) px += bmp->width;
+            columns[y*w + x] = (uint16)px;
 
             tx += yjump;
         }
@@ -1251,7 +1922,67 @@ void g_draw_3D_floor(Graphics* g, Bitmap* bmp,
 
         xjump -= xjumpDelta;
         yjump -= yjumpDelta;
-        
+    }
+
+    t->bmp = bmp;
+    t->w = w;
+    t->h = h;
+    t->mx = mx;
+    t->my = my;
+
+    return 0;
+}
+
+
+// Draw "3D" floor
+void g_draw_3D_floor(Graphics* g, Bitmap* bmp,
+    int dx, int dy, int w, int h, int xdelta,
+    int mx, int my) {
+
+    int x, y;
+    int px;
+    int startx, endx;
+    uint8* out;
+    const uint8* row;
+    const uint16* columns;
+    FloorTable* t = g->floor;
+
+    RECORD_COMMAND(g, Command3DFloor, bmp, FloorCommand,
+        dx, dy, w, h, xdelta, mx, my);
+
+    // Translate
+    dx += g->translation.x;
+    dy += g->translation.y;
+    w -= g->translation.x;
+    h -= g->translation.y;
+
+    if (bmp == NULL || w <= 0 || h <= 0 ||
+        build_floor_table(t, bmp, w, h, mx, my) == -1)
+        return;
+
+    // Scrolling, in [0, width)
+    xdelta %= bmp->width;
+    if (xdelta < 0) xdelta += bmp->width;
+
+    // Clip
+    startx = max_int32_2(dx, 0);
+    endx = min_int32_2(dx + w, g->csize.x);
+    g_mark_dirty(g, dx, dy, w, h);
+
+    for (y = max_int32_2(dy, g->clipTop); 
+         y < min_int32_2(dy + h, g->clipBottom); ++ y) {
+
+        row = bmp->data + t->rows[y-dy];
+        columns = t->columns + (y-dy)*w;
+        out = g->pdata + y*g->csize.x;
+
+        for (x = startx; x < endx; ++ x) {
+
+            px = columns[x-dx] - xdelta;
+            if (px < 0) px += bmp->width;
+
+            out[x] = row[px];
+        }
     }    
 }
 
@@ -1264,6 +1995,9 @@ void g_set_uv_coords(Graphics* g,
 
     const float EPS = 0.001f;
 
+    RECORD_COMMAND(g, CommandUVCoords, NULL, UVCommand,
+        u1, v1, u2, v2, u3, v3);
+
     // Check if coordinates are linearly dependable
     if ( fabsf((u3-u1)*(v3-v1) - (u2-u1)*(v2-v1)) < EPS ) {
 
@@ -1283,34 +2017,71 @@ void g_set_uv_coords(Graphics* g,
 // Enable texturing (pass NULL texture to disable)
 void g_toggle_texturing(Graphics* g, Bitmap* tex) {
 
+    RECORD_COMMAND(g, CommandTexture, tex, IntCommand, 0);
+
     g->tex = tex;
-    if (tex == NULL || tex->width <= 0 || tex->height <= 0)
+    if (tex == NULL || tex->width <= 0 || tex->height <= 0) {
+
         g->pfunc = pfunc_default;
+        g->pmode = PixelFunctionDefault;
+    }
 }
 
 
-// Darken the screen
-void g_darken(Graphics* g, int level) {
+// Darken the given rows of a canvas-sized buffer
+static void darken_rows(Graphics* g, uint8* data, 
+    int level, int top, int bottom) {
 
     int x, y;
-    int offset;
-
-    for (y = 0; y < g->csize.y; ++ y) {
-
-        for (x = 0; x < g->csize.x; ++ x) {
+    uint8* row;
+    const uint8* even;
+    const uint8* odd;
+    int w = g->csize.x;
+
+    for (y = top; y < bottom; ++ y) {
+
+        // The dither pattern alternates between two
+        // palettes, pick them once per row
+        even = g->darray[ ditherArray[level] [y % 2 == 0] ];
+        odd = g->darray[ ditherArray[level] [y % 2 == 1] ];
+
+        row = data + y*w;
+        for (x = 0; x + 8 <= w; x += 8) {
+
+            row[x] = even[row[x]];
+            row[x+1] = odd[row[x+1]];
+            row[x+2] = even[row[x+2]];
+            row[x+3] = odd[row[x+3]];
+            row[x+4] = even[row[x+4]];
+            row[x+5] = odd[row[x+5]];
+            row[x+6] = even[row[x+6]];
+            row[x+7] = odd[row[x+7]];
+        }
+        for (; x < w; ++ x) {
 
-            offset = y * g->csize.x + x;
-            g->pdata[offset] 
-                = g->darray[ ditherArray[level] [ x % 2 == y % 2] ] [g->pdata[offset] ];
+            row[x] = (x % 2 == 0 ? even : odd) [row[x]];
         }
     }
 }
 
 
+// Darken the screen
+void g_darken(Graphics* g, int level) {
+
+    RECORD_COMMAND(g, CommandDarken, NULL, IntCommand, level);
+
+    g_mark_dirty(g, 0, 0, g->csize.x, g->csize.y);
+
+    darken_rows(g, g->pdata, level, g->clipTop, g->clipBottom);
+}
+
+
 // Set darkness tint color
 // (I know right)
 void g_set_darkness_color(Graphics* g, uint8 col) {
 
+    RECORD_COMMAND(g, CommandDarknessColor, NULL, IntCommand, col);
+
     switch (col)
     {
     case ColorBlack:
@@ -1332,18 +2103,51 @@ void g_set_darkness_color(Graphics* g, uint8 col) {
 // Copy current screen to the buffer
 void g_copy_to_buffer(Graphics* g) {
 
+    RECORD_COMMAND(g, CommandCopyToBuffer, NULL, IntCommand, 0);
+
     memcpy(g->pbuffer, g->pdata, g->csize.x*g->csize.y);
 }
 
 
+// Store the current screen, darkened, as a backdrop
+void g_freeze_backdrop(Graphics* g, int level) {
+
+    RECORD_COMMAND(g, CommandFreezeBackdrop, NULL, IntCommand, level);
+
+    memcpy(g->pbackdrop, g->pdata, g->csize.x*g->csize.y);
+    darken_rows(g, g->pbackdrop, level, 0, g->csize.y);
+}
+
+
+// Draw the stored backdrop over the whole screen
+void g_draw_backdrop(Graphics* g) {
+
+    RECORD_COMMAND(g, CommandBackdrop, NULL, IntCommand, 0);
+
+    g_mark_dirty(g, 0, 0, g->csize.x, g->csize.y);
+
+    memcpy(g->pdata + g->clipTop*g->csize.x, 
+        g->pbackdrop + g->clipTop*g->csize.x,
+        (g->clipBottom-g->clipTop)*g->csize.x);
+}
+
+
 // Fill the screen with zoomed rotated bitmap
 void g_fill_zoomed_rotated(Graphics* g, Bitmap* bmp,
     float angle, float sx, float sy) {
 
     int x, y;
-    int px, py;
+    int u, v;
     int tx, ty;
-    int offset;
+    int fx, fy;
+    uint8* out;
+    int w = bmp->width;
+    int h = bmp->height;
+
+    RECORD_COMMAND(g, CommandZoomedRotated, bmp, ZoomCommand,
+        angle, sx, sy);
+
+    g_mark_dirty(g, 0, 0, g->csize.x, g->csize.y);
 
     // Transition
     Point tr = point(bmp->width/2, bmp->height/2);
@@ -1355,25 +2159,63 @@ void g_fill_zoomed_rotated(Graphics* g, Bitmap* bmp,
     int scalex = (int) (sx * FIXED_PREC);
     int scaley = (int) (sy * FIXED_PREC);
 
-    for (y = 0; y < g->csize.y; ++ y) {
+    // Texture coordinate steps along a row. The coordinates
+    // are in 16.16 fixed point (precision squared)
+    int du = scalex * c;
+    int dv = scalex * s;
 
-        for (x = 0; x < g->csize.x; ++ x) {
+    // Integer and fraction parts of the steps, the 
+    // integer part wrapped to the bitmap size
+    int dtx = (du >> 16) % w;
+    int dty = (dv >> 16) % h;
+    int dfx = du & 0xFFFF;
+    int dfy = dv & 0xFFFF;
+    if (dtx < 0) dtx += w;
+    if (dty < 0) dty += h;
+
+    bool pow2 = (w & (w-1)) == 0 && (h & (h-1)) == 0;
+
+    for (y = g->clipTop; y < g->clipBottom; ++ y) {
+
+        // Texture coordinates at the beginning of the row
+        u = -tr.x * du - (y-tr.y) * scaley * s - (tr.x << 16);
+        v = -tr.x * dv + (y-tr.y) * scaley * c - (tr.y << 16);
+
+        out = g->pdata + y*g->csize.x;
 
-            px = (x-tr.x) * scalex / FIXED_PREC;
-            py = (y-tr.y) * scaley / FIXED_PREC;
+        // Power of two bitmaps can be wrapped with a mask
+        if (pow2) {
 
-            // Compute transformed pixel position
-            tx = ( px * c - py * s) / FIXED_PREC;
-            ty = ( px * s + py * c) / FIXED_PREC;
+            for (x = 0; x < g->csize.x; ++ x) {
 
-            tx -= tr.x;
-            ty -= tr.y;
+                out[x] = bmp->data[((v >> 16) & (h-1))*w + ((u >> 16) & (w-1))];
+                u += du;
+                v += dv;
+            }
+            continue;
+        }
+
+        // Otherwise keep the integer part inside the 
+        // bitmap, and carry the fraction part to it
+        tx = (u >> 16) % w;
+        ty = (v >> 16) % h;
+        if (tx < 0) tx += w;
+        if (ty < 0) ty += h;
+        fx = u & 0xFFFF;
+        fy = v & 0xFFFF;
+
+        for (x = 0; x < g->csize.x; ++ x) {
 
-            tx = neg_mod(tx, bmp->width);
-            ty = neg_mod(ty, bmp->height);
+            out[x] = bmp->data[ty*w + tx];
 
-            offset = y * g->csize.x + x;
-            g->pdata[offset] = bmp->data[ty*bmp->width + tx];
+            fx += dfx;
+            fy += dfy;
+            tx += dtx + (fx >> 16);
+            ty += dty + (fy >> 16);
+            fx &= 0xFFFF;
+            fy &= 0xFFFF;
+            if (tx >= w) tx -= w;
+            if (ty >= h) ty -= h;
         }
     }
 }
@@ -1384,6 +2226,8 @@ void g_fill_zoomed_rotated(Graphics* g, Bitmap* bmp,
 void g_fill_circle_outside(Graphics* g, 
     int r, uint8 col) {
 
+    RECORD_COMMAND(g, CommandCircleOutside, NULL, IntCommand, r, col);
+
     if (r <= 0) {
 
         g_clear_screen(g, col);
@@ -1392,40 +2236,240 @@ void g_fill_circle_outside(Graphics* g,
     else if(r*r >= g->csize.x*g->csize.x + g->csize.y*g->csize.y)
         return;
 
-    int x, y;
+    g_mark_dirty(g, 0, 0, g->csize.x, g->csize.y);
+
+    int y;
     int dy;
+    int rem;
     int px1, px2;
-    for (y = 0; y < g->csize.y; ++ y) {
+    uint8* out;
+    SpanFunction fill = spanCopyFuncs[g->pmode];
 
-        if ( abs(y - g->csize.y/2) >= r ) {
+    // Half width of the circle on the current row,
+    // the integer part of sqrt(r*r - dy*dy)
+    int hw = 0;
 
-            for (x = 0; x < g->csize.x; ++ x) {
+    for (y = g->clipTop; y < g->clipBottom; ++ y) {
 
-                g->pdata[y * g->csize.x + x] = col;
-            }
+        out = g->pdata + y*g->csize.x;
+
+        dy = y - g->csize.y/2;
+        if ( abs(dy) >= r ) {
 
+            memset(out, col, g->csize.x);
             continue;
         }
 
-        dy = y - g->csize.y/2;
-        px1 = g->csize.x/2 - (int) sqrt(r*r - dy*dy);
-        px2 = g->csize.x/2 + (int) sqrt(r*r - dy*dy);
+        // The half width changes only a little from
+        // row to row, so step it instead of computing
+        // the square root
+        rem = r*r - dy*dy;
+        while ((hw+1)*(hw+1) <= rem) 
+            ++ hw;
+        while (hw*hw > rem) 
+            -- hw;
+
+        // With an odd width, one side may still
+        // need filling when the other does not
+        px1 = max_int32_2(g->csize.x/2 - hw, 0);
+        px2 = min_int32_2(g->csize.x/2 + hw, g->csize.x);
+
+        // Fill left & right
+        if (px1 > 0)
+            fill(g, out, &col, 0, px1, 0, y);
+        if (px2 < g->csize.x)
+            fill(g, out + px2, &col, 0, g->csize.x-px2, px2, y);
+    }
+}
 
-        if (px1 <= 0 || px2 >= g->csize.x) {
 
-            continue;
-        }
+// Start recording draw calls to a command buffer
+void g_begin_recording(Graphics* g, CommandBuffer* buf) {
 
-        // Fill left
-        for (x = 0; x < px1; ++ x) {
+    uint8 dcolor = ColorBlack;
 
-            g->pfunc(g, y * g->csize.x + x, col);
-        }
+    cmdbuf_clear(buf);
+    g->cmdBuffer = buf;
 
-        // Fill right
-        for (x = px2; x < g->csize.x; ++ x) {
+    // Store the current state first, so the
+    // commands do not depend on the state of
+    // the graphics they are drawn with
+    if (g->darray == redPalette)
+        dcolor = ColorRed;
+    else if (g->darray == lpalette)
+        dcolor = ColorWhite;
 
-            g->pfunc(g, y * g->csize.x + x, col);
-        }
+    g_toggle_texturing(g, g->tex);
+    g_set_uv_coords(g, 
+        g->uv1.x, g->uv1.y, g->uv2.x, g->uv2.y, g->uv3.x, g->uv3.y);
+    g_set_pixel_function(g, g->pmode, g->pparam1, g->pparam2);
+    g_set_darkness_color(g, dcolor);
+    g_move_to(g, g->translation.x, g->translation.y);
+}
+
+
+// Stop recording
+void g_end_recording(Graphics* g) {
+
+    g->cmdBuffer = NULL;
+}
+
+
+// Execute a single command
+static void execute_command(Graphics* g, CommandHeader* h) {
+
+    BitmapCommand* b;
+    ShapeCommand* s;
+    IntCommand* i;
+    WaveCommand* w;
+    FloorCommand* f;
+    ZoomCommand* z;
+    UVCommand* uv;
+
+    switch (h->type)
+    {
+    case CommandClearScreen:
+        i = CMD_PARAMS(h, IntCommand);
+        g_clear_screen(g, (uint8)i->param1);
+        break;
+
+    case CommandDrawStatic:
+        g_draw_static(g);
+        break;
+
+    case CommandBitmapRegion:
+        b = CMD_PARAMS(h, BitmapCommand);
+        g_draw_bitmap_region(g, h->bmp, b->sx, b->sy, b->sw, b->sh,
+            b->dx, b->dy, b->flip);
+        break;
+
+    case CommandScaledBitmapRegion:
+        b = CMD_PARAMS(h, BitmapCommand);
+        g_draw_scaled_bitmap_region(g, h->bmp, b->sx, b->sy, b->sw, b->sh,
+            b->dx, b->dy, b->dw, b->dh, b->flip);
+        break;
+
+    case CommandBitmapRegionFast:
+        b = CMD_PARAMS(h, BitmapCommand);
+        g_draw_bitmap_region_fast(g, h->bmp, b->sx, b->sy, b->sw, b->sh,
+            b->dx, b->dy);
+        break;
+
+    case CommandWavingBitmap:
+        w = CMD_PARAMS(h, WaveCommand);
+        g_draw_waving_bitmap(g, h->bmp, w->x, w->y, 
+            w->wave, w->period, w->amplitude);
+        break;
+
+    case CommandFillRect:
+        s = CMD_PARAMS(h, ShapeCommand);
+        g_fill_rect(g, s->x1, s->y1, s->x2, s->y2, s->col);
+        break;
+
+    case CommandTriangle:
+        s = CMD_PARAMS(h, ShapeCommand);
+        g_draw_triangle(g, s->x1, s->y1, s->x2, s->y2, 
+            s->x3, s->y3, s->col);
+        break;
+
+    case CommandLine:
+        s = CMD_PARAMS(h, ShapeCommand);
+        g_draw_line(g, s->x1, s->y1, s->x2, s->y2, s->col);
+        break;
+
+    case Command3DFloor:
+        f = CMD_PARAMS(h, FloorCommand);
+        g_draw_3D_floor(g, h->bmp, f->x, f->y, f->w, f->h, 
+            f->xdelta, f->mx, f->my);
+        break;
+
+    case CommandDarken:
+        i = CMD_PARAMS(h, IntCommand);
+        g_darken(g, i->param1);
+        break;
+
+    case CommandCopyToBuffer:
+        g_copy_to_buffer(g);
+        break;
+
+    case CommandFreezeBackdrop:
+        i = CMD_PARAMS(h, IntCommand);
+        g_freeze_backdrop(g, i->param1);
+        break;
+
+    case CommandBackdrop:
+        g_draw_backdrop(g);
+        break;
+
+    case CommandZoomedRotated:
+        z = CMD_PARAMS(h, ZoomCommand);
+        g_fill_zoomed_rotated(g, h->bmp, z->angle, z->sx, z->sy);
+        break;
+
+    case CommandCircleOutside:
+        i = CMD_PARAMS(h, IntCommand);
+        g_fill_circle_outside(g, i->param1, (uint8)i->param2);
+        break;
+
+    case CommandPixelFunction:
+        i = CMD_PARAMS(h, IntCommand);
+        g_set_pixel_function(g, i->param1, i->param2, i->param3);
+        break;
+
+    case CommandTranslate:
+        i = CMD_PARAMS(h, IntCommand);
+        g_translate(g, i->param1, i->param2);
+        break;
+
+    case CommandMoveTo:
+        i = CMD_PARAMS(h, IntCommand);
+        g_move_to(g, i->param1, i->param2);
+        break;
+
+    case CommandUVCoords:
+        uv = CMD_PARAMS(h, UVCommand);
+        g_set_uv_coords(g, uv->u1, uv->v1, uv->u2, uv->v2, uv->u3, uv->v3);
+        break;
+
+    case CommandTexture:
+        g_toggle_texturing(g, h->bmp);
+        break;
+
+    case CommandDarknessColor:
+        i = CMD_PARAMS(h, IntCommand);
+        g_set_darkness_color(g, (uint8)i->param1);
+        break;
+    
+    default:
+        break;
     }
 }
+
+
+// Execute recorded commands in the byte range [begin, end)
+void g_execute_commands(Graphics* g, CommandBuffer* buf, 
+    uint32 begin, uint32 end) {
+
+    CommandHeader* h;
+    CommandBuffer* recording = g->cmdBuffer;
+
+    // Commands must be drawn, not recorded again
+    g->cmdBuffer = NULL;
+
+    while (begin < end) {
+
+        h = cmdbuf_get(buf, begin);
+        execute_command(g, h);
+
+        begin += h->size;
+    }
+
+    g->cmdBuffer = recording;
+}
+
+
+// Draw all the commands in a buffer
+void g_draw_commands(Graphics* g, CommandBuffer* buf) {
+
+    g_execute_commands(g, buf, 0, buf->size);
+}
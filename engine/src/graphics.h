@@ -13,6 +13,7 @@
 
 #include "bitmap.h"
 #include "config.h"
+#include "cmdbuffer.h"
 
 
 // Initialize global graphics content
@@ -47,11 +48,45 @@ enum {
     PixelFunctionLighten = 10,
 };
 
+// Maximum number of changed areas
+// tracked before merging them
+#define MAX_DIRTY_RECTS 16
+
+// Changed areas of the canvas, uploaded 
+// to the canvas texture on update
+typedef struct {
+
+    SDL_Rect rects [MAX_DIRTY_RECTS];
+    int count;
+
+} DirtyRects;
+
+// Row tables for the "3D" floor. Only the
+// scrolling changes between frames, so the
+// texture positions are computed once
+typedef struct {
+
+    // Parameters the tables are for
+    Bitmap* bmp;
+    int w, h;
+    int mx, my;
+
+    // Offset of the texture row of every row
+    uint32* rows;
+    // Texture column of every pixel, before 
+    // scrolling, w*h entries
+    uint16* columns;
+
+} FloorTable;
+
 // Graphics type
 typedef struct {
 
     SDL_Window* window;
     SDL_Renderer* rend;
+    // No window, renderer or canvas texture, 
+    // only the pixel data is drawn to
+    bool headless;
 
     // Canvas target size
     Point csize;
@@ -71,10 +106,21 @@ typedef struct {
     uint8* pbuffer;
     // ...and as a bitmap format
     Bitmap bufferCopy;
+    // Darkened copy of the screen, drawn behind
+    // overlays like the pause menu
+    uint8* pbackdrop;
 
     // Translation
     Point translation;
 
+    // Rows that can be drawn to, [clipTop, clipBottom)
+    int clipTop;
+    int clipBottom;
+
+    // If not NULL, draw calls are recorded
+    // to this buffer instead
+    CommandBuffer* cmdBuffer;
+
     // Darkness value
     int dvalue;
     // Darkness array
@@ -82,6 +128,7 @@ typedef struct {
 
     // Pixel function & param
     void (*pfunc) (void* g, int offset, uint8 col);
+    int pmode;
     int pparam1;
     int pparam2;
 
@@ -92,9 +139,21 @@ typedef struct {
     Point top;
     Bitmap* tex;
 
+    // Floor tables
+    FloorTable* floor;
+
+    // Changed areas
+    DirtyRects dirty;
+
+    // Random state for static, separate from rand()
+    // so that drawing does not change the game
+    uint32 noise;
+
 } Graphics;
 
-// Create a graphics component
+// Create a graphics component. If the window is NULL
+// or "headless" is set in the configuration, nothing
+// is shown, but the drawing functions work as usual
 Graphics* create_graphics(SDL_Window* window, Config* conf);
 
 // Dispose graphics
@@ -111,7 +170,23 @@ void g_translate(Graphics* g, int tx, int ty);
 // Move to
 void g_move_to(Graphics* g, int dx, int dy);
 
-// Pass data to the canvas
+// Start recording draw calls to a command buffer. 
+// The current state is recorded first, so the buffer
+// can be drawn with any graphics later
+void g_begin_recording(Graphics* g, CommandBuffer* buf);
+// Stop recording
+void g_end_recording(Graphics* g);
+// Execute recorded commands in the byte range [begin, end)
+void g_execute_commands(Graphics* g, CommandBuffer* buf, 
+    uint32 begin, uint32 end);
+// Draw all the commands in a buffer
+void g_draw_commands(Graphics* g, CommandBuffer* buf);
+
+// Mark an area of the canvas changed. Only needed
+// if the canvas data is modified directly
+void g_mark_dirty(Graphics* g, int x, int y, int w, int h);
+
+// Pass the changed areas to the canvas
 void g_update_pixel_data(Graphics* g);
 // Refresh & draw the canvas
 void g_refresh(Graphics* g);
@@ -191,6 +266,11 @@ void g_set_darkness_color(Graphics* g, uint8 col);
 // Copy current screen to the buffer
 void g_copy_to_buffer(Graphics* g);
 
+// Store the current screen, darkened, as a backdrop
+void g_freeze_backdrop(Graphics* g, int level);
+// Draw the stored backdrop over the whole screen
+void g_draw_backdrop(Graphics* g);
+
 // Fill the screen with zoomed rotated bitmap
 void g_fill_zoomed_rotated(Graphics* g, Bitmap* bmp, 
     float angle, float sx, float sy);
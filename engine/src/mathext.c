@@ -1,6 +1,30 @@
 #include "mathext.h"
 
 #include <stdbool.h>
+#include <math.h>
+
+// Sine table, a quarter turn longer so the 
+// cosine can be read from the same table
+static int sinTable [TRIG_TABLE_SIZE + TRIG_TABLE_SIZE/4];
+
+
+// Angle in radians to table steps
+static int angle_to_steps(float angle) {
+
+    float a = angle * (float)TRIG_TABLE_SIZE / (2.0f * (float)M_PI);
+
+    return (int)(a >= 0.0f ? a + 0.5f : a - 0.5f);
+}
+
+
+// Arctangent in [0, 1]
+static float atan_unit(float z) {
+
+    float z2 = z*z;
+
+    return z * (0.9998660f + z2 * (-0.3302995f + z2 * 
+        (0.1801410f + z2 * (-0.0851330f + z2 * 0.0208351f))));
+}
 
 
 // Sort a point triplet by the second
@@ -102,3 +126,81 @@ int round_fixed(int n, int p) {
         return n / p +1;
     }
 }
+
+
+// Build the trigonometric tables
+void init_trig_tables() {
+
+    int i;
+    for (i = 0; i < TRIG_TABLE_SIZE + TRIG_TABLE_SIZE/4; ++ i) {
+
+        sinTable[i] = (int)lround(
+            sin(2.0 * M_PI * i / TRIG_TABLE_SIZE) * TRIG_PREC);
+    }
+}
+
+
+// Sine in fixed point
+int sin_fixed(int a) {
+
+    return sinTable[a & (TRIG_TABLE_SIZE-1)];
+}
+
+
+// Cosine in fixed point
+int cos_fixed(int a) {
+
+    return sinTable[(a & (TRIG_TABLE_SIZE-1)) + TRIG_TABLE_SIZE/4];
+}
+
+
+// Sine using the table
+float fast_sin(float angle) {
+
+    return (float)sin_fixed(angle_to_steps(angle)) / TRIG_PREC;
+}
+
+
+// Cosine using the table
+float fast_cos(float angle) {
+
+    return (float)cos_fixed(angle_to_steps(angle)) / TRIG_PREC;
+}
+
+
+// Arctangent, approximated
+float fast_atan2(float y, float x) {
+
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float a;
+
+    if (ax == 0.0f && ay == 0.0f)
+        return 0.0f;
+
+    // Reduce to [0, 1] and mirror back
+    if (ax >= ay)
+        a = atan_unit(ay / ax);
+    else
+        a = (float)M_PI/2.0f - atan_unit(ax / ay);
+
+    if (x < 0.0f)
+        a = (float)M_PI - a;
+    if (y < 0.0f)
+        a = -a;
+
+    return a;
+}
+
+
+// Xorshift random number generator
+uint32 xorshift32(uint32* state) {
+
+    uint32 x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return (*state = x);
+}
@@ -26,4 +26,29 @@ int neg_mod(int m, int n);
 // Round fixed point number
 int round_fixed(int n, int p);
 
+// Angle steps in a full turn in the 
+// trigonometric tables
+#define TRIG_TABLE_SIZE 4096
+// Precision of the table values
+#define TRIG_PREC 65536
+
+// Build the trigonometric tables
+void init_trig_tables();
+
+// Sine & cosine in fixed point, the angle 
+// given in table steps
+int sin_fixed(int a);
+int cos_fixed(int a);
+
+// Sine, cosine & arctangent using the tables
+// and approximations instead of libm
+float fast_sin(float angle);
+float fast_cos(float angle);
+float fast_atan2(float y, float x);
+
+// Xorshift random number generator, for when 
+// rand() would consume numbers the game logic
+// depends on. The state must not be zero
+uint32 xorshift32(uint32* state);
+
 #endif // __MATHEXT__
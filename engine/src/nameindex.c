@@ -0,0 +1,81 @@
+#include "nameindex.h"
+
+#include <string.h>
+
+// FNV-1a parameters
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+
+// Find the slot of a name, or the empty
+// slot where it would be added
+static uint32 find_slot(NameIndex* ni, const char* name, uint32 hash,
+    const char* names, size_t stride) {
+
+    uint32 i = hash & (NAME_INDEX_SIZE-1);
+    int index;
+
+    // Linear probing. There is always an
+    // empty slot, since the table is larger
+    // than the arrays
+    while (ni->slots[i] != 0) {
+
+        index = ni->slots[i] - 1;
+        if (ni->hashes[i] == hash &&
+            strcmp(names + index*stride, name) == 0) {
+
+            break;
+        }
+        i = (i + 1) & (NAME_INDEX_SIZE-1);
+    }
+
+    return i;
+}
+
+
+// Hash a string
+uint32 hash_string(const char* str) {
+
+    uint32 hash = FNV_OFFSET;
+
+    for (; *str != '\0'; ++ str) {
+
+        hash ^= (uint8)*str;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+
+// Initialize an empty name index
+void init_name_index(NameIndex* ni) {
+
+    memset(ni->slots, 0, sizeof(ni->slots));
+}
+
+
+// Add an array element
+void nindex_add(NameIndex* ni, int index,
+    const char* names, size_t stride) {
+
+    const char* name = names + index*stride;
+    uint32 hash = hash_string(name);
+    uint32 i = find_slot(ni, name, hash, names, stride);
+
+    // The first element of the name is found,
+    // as when searching the array in order
+    if (ni->slots[i] != 0) return;
+
+    ni->slots[i] = (uint16)(index + 1);
+    ni->hashes[i] = hash;
+}
+
+
+// Find an array element by its name
+int nindex_find(NameIndex* ni, const char* name,
+    const char* names, size_t stride) {
+
+    uint32 i = find_slot(ni, name, hash_string(name), names, stride);
+
+    return (int)ni->slots[i] - 1;
+}
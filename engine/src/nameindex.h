@@ -0,0 +1,48 @@
+//
+// Name index
+// (c) 2019 Jani Nykänen
+//
+
+#ifndef __NAME_INDEX__
+#define __NAME_INDEX__
+
+#include "types.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Number of hash table slots. A power of two, and
+// at least twice the size of the largest array
+// indexed, so that the probe sequences stay short
+#define NAME_INDEX_SIZE 512
+
+// Hash table that finds elements of an array by
+// their names. The names are stored in the array,
+// "stride" bytes apart
+typedef struct {
+
+    // Array index + 1, 0 if the slot is empty
+    uint16 slots [NAME_INDEX_SIZE];
+    // Name hashes, most mismatches are
+    // found without comparing the names
+    uint32 hashes [NAME_INDEX_SIZE];
+
+} NameIndex;
+
+// Hash a string
+uint32 hash_string(const char* str);
+
+// Initialize an empty name index
+void init_name_index(NameIndex* ni);
+
+// Add an array element. If the name is already
+// in the index, the first element is kept
+void nindex_add(NameIndex* ni, int index,
+    const char* names, size_t stride);
+
+// Find an array element by its name,
+// -1 if not found
+int nindex_find(NameIndex* ni, const char* name,
+    const char* names, size_t stride);
+
+#endif // __NAME_INDEX__
@@ -0,0 +1,142 @@
+#include "perfoverlay.h"
+
+#include "mathext.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Colors (RGB332)
+#define COLOR_BACKGROUND 0
+#define COLOR_GOOD 28
+#define COLOR_BAD 224
+#define COLOR_TARGET 109
+
+
+// Create a performance overlay
+PerfOverlay create_perf_overlay() {
+
+    PerfOverlay p;
+    int i;
+
+    p.active = false;
+    p.font = NULL;
+
+    for (i = 0; i < PERF_HISTORY; ++ i) {
+
+        p.history[i] = 0.0f;
+    }
+    p.historyPos = 0;
+
+    p.frameTime = 0.0f;
+    p.updateTime = 0.0f;
+    p.drawTime = 0.0f;
+    p.updateCount = 0;
+    p.dropped = 0;
+    p.missed = 0;
+    p.targetTime = 1.0f;
+
+    p.lastFrame = SDL_GetPerformanceCounter();
+
+    return p;
+}
+
+
+// Toggle
+void perf_toggle(PerfOverlay* p) {
+
+    p->active = !p->active;
+}
+
+
+// Store the timings of a drawn frame
+void perf_add_frame(PerfOverlay* p, 
+    float updateTime, float drawTime, 
+    int updateCount, int dropped, int missed, 
+    float targetTime) {
+
+    Uint64 time = SDL_GetPerformanceCounter();
+
+    p->frameTime = (float)((double)(time - p->lastFrame) * 1000.0 / 
+        (double)SDL_GetPerformanceFrequency());
+    p->lastFrame = time;
+
+    p->updateTime = updateTime;
+    p->drawTime = drawTime;
+    p->updateCount = updateCount;
+    p->dropped = dropped;
+    p->missed = missed;
+    p->targetTime = targetTime;
+
+    p->history[p->historyPos] = p->frameTime;
+    p->historyPos = (p->historyPos + 1) % PERF_HISTORY;
+}
+
+
+// Draw
+void perf_draw(PerfOverlay* p, Graphics* g) {
+
+    const int LINE_COUNT = 3;
+    const int LINE_HEIGHT = 9;
+    const int MARGIN = 2;
+    const int BAR_WIDTH = 2;
+    // Two updates worth of time fill the graph
+    const int GRAPH_HEIGHT = 24;
+    const int XOFF = -1;
+
+    int i, h;
+    float t;
+    char buf [3][48];
+
+    if (!p->active || p->font == NULL) return;
+
+    // Timings
+    snprintf(buf[0], 48, "FRAME %.1f MS", p->frameTime);
+    snprintf(buf[1], 48, "UPD %.2f DRAW %.2f", 
+        p->updateTime, p->drawTime);
+    snprintf(buf[2], 48, "UPF %d DROP %d MISS %d", 
+        p->updateCount, p->dropped, p->missed);
+
+    // Wide enough for the graph and the longest
+    // line, since the counts and times can grow
+    int charWidth = p->font->width/16 + XOFF;
+    int width = PERF_HISTORY * BAR_WIDTH;
+    for (i = 0; i < LINE_COUNT; ++ i) {
+
+        width = max_int32_2(width, (int)strlen(buf[i]) * charWidth);
+    }
+    width += MARGIN*2;
+
+    int height = LINE_COUNT*LINE_HEIGHT + GRAPH_HEIGHT + MARGIN*3;
+    int x = 0;
+    int y = g->csize.y - height;
+    int graphBottom = y + MARGIN*2 + LINE_COUNT*LINE_HEIGHT + GRAPH_HEIGHT;
+
+    // Drawn last, on top of everything, so the
+    // translation of the scene can be reset
+    g_move_to(g, 0, 0);
+
+    g_fill_rect(g, x, y, width, height, COLOR_BACKGROUND);
+
+    for (i = 0; i < LINE_COUNT; ++ i) {
+
+        g_draw_text(g, p->font, buf[i], 
+            x + MARGIN, y + MARGIN + i*LINE_HEIGHT, 
+            XOFF, 0, false);
+    }
+
+    // Frame times, the oldest first
+    for (i = 0; i < PERF_HISTORY; ++ i) {
+
+        t = p->history[(p->historyPos + i) % PERF_HISTORY];
+        h = min_int32_2(GRAPH_HEIGHT, 
+            (int)(t / (p->targetTime*2.0f) * GRAPH_HEIGHT));
+
+        g_fill_rect(g, x + MARGIN + i*BAR_WIDTH, graphBottom - h,
+            BAR_WIDTH, h, 
+            t > p->targetTime*1.5f ? COLOR_BAD : COLOR_GOOD);
+    }
+
+    // Target
+    g_fill_rect(g, x + MARGIN, graphBottom - GRAPH_HEIGHT/2, 
+        PERF_HISTORY * BAR_WIDTH, 1, COLOR_TARGET);
+}
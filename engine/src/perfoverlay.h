@@ -0,0 +1,63 @@
+//
+// Performance overlay
+// (c) 2019 Jani Nykänen
+//
+
+#ifndef __PERF_OVERLAY__
+#define __PERF_OVERLAY__
+
+#include "graphics.h"
+#include "bitmap.h"
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+// Frames shown in the graph
+#define PERF_HISTORY 64
+
+// Performance overlay type
+typedef struct {
+
+    bool active;
+    // Font, nothing is drawn without one
+    Bitmap* font;
+
+    // Frame times in milliseconds, the
+    // latest at historyPos-1
+    float history [PERF_HISTORY];
+    int historyPos;
+
+    // Latest frame, in milliseconds
+    float frameTime;
+    float updateTime;
+    float drawTime;
+    // Updates on the latest frame
+    int updateCount;
+    // Updates that were never drawn
+    int dropped;
+    // Updates that were late
+    int missed;
+    // Time of one update
+    float targetTime;
+
+    Uint64 lastFrame;
+
+} PerfOverlay;
+
+// Create a performance overlay
+PerfOverlay create_perf_overlay();
+
+// Toggle
+void perf_toggle(PerfOverlay* p);
+
+// Store the timings of a drawn frame
+void perf_add_frame(PerfOverlay* p, 
+    float updateTime, float drawTime, 
+    int updateCount, int dropped, int missed, 
+    float targetTime);
+
+// Draw
+void perf_draw(PerfOverlay* p, Graphics* g);
+
+#endif // __PERF_OVERLAY__
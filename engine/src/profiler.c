@@ -0,0 +1,123 @@
+#include "profiler.h"
+
+#include "err.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+// Ring buffer, NULL if not profiling
+static ProfSample* samples = NULL;
+static uint32 mask;
+// Number of samples added so far. Writers 
+// reserve a slot by incrementing it
+static SDL_atomic_t head;
+
+// Timer
+static Uint64 startTime;
+static double usPerTick;
+
+
+// Initialize
+int prof_init(int capacity) {
+
+    uint32 size = 1;
+
+    // Power of two, so that the index can wrap
+    while (size < (uint32)capacity) {
+
+        size <<= 1;
+    }
+
+    samples = (ProfSample*)malloc(sizeof(ProfSample) * size);
+    if (samples == NULL) {
+
+        ERR_MEM_ALLOC;
+        return -1;
+    }
+    mask = size - 1;
+    SDL_AtomicSet(&head, 0);
+
+    startTime = SDL_GetPerformanceCounter();
+    usPerTick = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+
+    return 0;
+}
+
+
+// Dispose
+void prof_dispose() {
+
+    if (samples == NULL) return;
+
+    free(samples);
+    samples = NULL;
+}
+
+
+// Begin a zone
+Uint64 prof_begin() {
+
+    if (samples == NULL) return 0;
+
+    return SDL_GetPerformanceCounter();
+}
+
+
+// End a zone
+void prof_end(const char* name, Uint64 start) {
+
+    ProfSample* s;
+
+    if (samples == NULL) return;
+
+    s = &samples[(uint32)SDL_AtomicAdd(&head, 1) & mask];
+    s->name = name;
+    s->start = start;
+    s->end = SDL_GetPerformanceCounter();
+    s->thread = SDL_ThreadID();
+}
+
+
+// Write samples in Chrome trace format
+int prof_write_chrome_trace(const char* path) {
+
+    uint32 i;
+    uint32 count, first;
+    ProfSample* s;
+
+    if (samples == NULL) return 0;
+
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+
+        err_throw_param_1("Failed to create a file in ", path);
+        return -1;
+    }
+
+    // If the buffer is full, the oldest
+    // samples have been overwritten
+    count = (uint32)SDL_AtomicGet(&head);
+    first = 0;
+    if (count > mask + 1) {
+
+        first = count - (mask + 1);
+    }
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    for (i = first; i < count; ++ i) {
+
+        s = &samples[i & mask];
+        fprintf(f, 
+            "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,"
+            "\"ts\":%.3f,\"dur\":%.3f}%s\n",
+            s->name, (unsigned long)s->thread,
+            (double)(s->start - startTime) * usPerTick,
+            (double)(s->end - s->start) * usPerTick,
+            i + 1 < count ? "," : "");
+    }
+    fprintf(f, "],\"displayTimeUnit\":\"ms\"}\n");
+
+    fclose(f);
+
+    return 0;
+}
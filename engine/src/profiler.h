@@ -0,0 +1,52 @@
+//
+// Profiling zones
+// (c) 2019 Jani Nykänen
+//
+
+#ifndef __PROFILER__
+#define __PROFILER__
+
+#include "types.h"
+
+#include <SDL2/SDL.h>
+
+// Time spent between prof_begin and prof_end is
+// stored as a sample in a ring buffer that keeps
+// the latest samples. Any thread may add samples.
+// Does nothing if the profiler is not initialized
+//
+// Usage:
+//   Uint64 zone = prof_begin();
+//   ...
+//   prof_end("name", zone);
+
+// Sample type
+typedef struct {
+
+    // Must stay valid until the samples are
+    // written, use string literals
+    const char* name;
+    Uint64 start;
+    Uint64 end;
+    SDL_threadID thread;
+
+} ProfSample;
+
+// Initialize the profiler, keeping (at least)
+// the given number of latest samples
+int prof_init(int capacity);
+
+// Dispose the samples
+void prof_dispose();
+
+// Begin a zone
+Uint64 prof_begin();
+
+// End a zone
+void prof_end(const char* name, Uint64 start);
+
+// Write the samples to a file in the Chrome
+// trace format (chrome://tracing)
+int prof_write_chrome_trace(const char* path);
+
+#endif // __PROFILER__
@@ -0,0 +1,198 @@
+#include "renderthread.h"
+
+#include "err.h"
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+// Draw the submitted frames
+static int thread_render(void* param) {
+
+    RenderThread* rt = (RenderThread*)param;
+    CommandBuffer* buf;
+
+    SDL_LockMutex(rt->mutex);
+    while (true) {
+
+        while (rt->pending == NULL && rt->running) {
+
+            SDL_CondWait(rt->start, rt->mutex);
+        }
+        if (!rt->running) break;
+
+        buf = rt->pending;
+        SDL_UnlockMutex(rt->mutex);
+
+        Uint64 zone = prof_begin();
+        if (rt->br != NULL)
+            br_render(rt->br, &rt->g, buf);
+        else
+            g_draw_commands(&rt->g, buf);
+        prof_end("render_thread", zone);
+
+        SDL_LockMutex(rt->mutex);
+        rt->pending = NULL;
+        SDL_CondSignal(rt->done);
+    }
+    SDL_UnlockMutex(rt->mutex);
+
+    return 0;
+}
+
+
+// Create a render thread
+RenderThread* create_render_thread(Graphics* g, 
+    BandRenderer* br, uint32 bufferSize) {
+
+    int i;
+    int size = g->csize.x * g->csize.y;
+
+    // Allocate memory
+    RenderThread* rt = (RenderThread*)calloc(1, sizeof(RenderThread));
+    if (rt == NULL) {
+
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
+
+    // Own canvas, starting from the current one
+    rt->g = *g;
+    rt->g.cmdBuffer = NULL;
+    rt->g.dirty.count = 0;
+    rt->g.pdata = (uint8*)malloc(size);
+    if (rt->g.pdata == NULL) {
+
+        ERR_MEM_ALLOC;
+        free(rt);
+        return NULL;
+    }
+    memcpy(rt->g.pdata, g->pdata, size);
+    rt->br = br;
+
+    for (i = 0; i < 2; ++ i) {
+
+        rt->buffers[i] = create_command_buffer(bufferSize);
+        if (rt->buffers[i] == NULL) {
+
+            dispose_render_thread(rt);
+            return NULL;
+        }
+    }
+    rt->current = 0;
+    rt->pending = NULL;
+
+    // Start the thread
+    rt->running = true;
+    rt->mutex = SDL_CreateMutex();
+    rt->start = SDL_CreateCond();
+    rt->done = SDL_CreateCond();
+    if (rt->mutex == NULL || rt->start == NULL || rt->done == NULL) {
+
+        err_throw_param_1("SDL2 ERROR: ", SDL_GetError());
+        dispose_render_thread(rt);
+        return NULL;
+    }
+    rt->thread = SDL_CreateThread(thread_render, "render", (void*)rt);
+    if (rt->thread == NULL) {
+
+        err_throw_param_1("SDL2 ERROR: ", SDL_GetError());
+        dispose_render_thread(rt);
+        return NULL;
+    }
+
+    return rt;
+}
+
+
+// Dispose a render thread
+void dispose_render_thread(RenderThread* rt) {
+
+    if (rt == NULL) return;
+
+    // Stop the thread
+    if (rt->thread != NULL) {
+
+        SDL_LockMutex(rt->mutex);
+        rt->running = false;
+        SDL_CondSignal(rt->start);
+        SDL_UnlockMutex(rt->mutex);
+
+        SDL_WaitThread(rt->thread, NULL);
+    }
+
+    if (rt->done != NULL)
+        SDL_DestroyCond(rt->done);
+    if (rt->start != NULL)
+        SDL_DestroyCond(rt->start);
+    if (rt->mutex != NULL)
+        SDL_DestroyMutex(rt->mutex);
+
+    dispose_command_buffer(rt->buffers[0]);
+    dispose_command_buffer(rt->buffers[1]);
+    free(rt->g.pdata);
+    free(rt);
+}
+
+
+// Get the buffer to record to
+CommandBuffer* rt_get_buffer(RenderThread* rt) {
+
+    return rt->buffers[rt->current];
+}
+
+
+// Wait for the previous frame
+void rt_finish(RenderThread* rt, Graphics* g) {
+
+    int i, y;
+    SDL_Rect* r;
+    Graphics old;
+
+    SDL_LockMutex(rt->mutex);
+    while (rt->pending != NULL) {
+
+        SDL_CondWait(rt->done, rt->mutex);
+    }
+    SDL_UnlockMutex(rt->mutex);
+
+    // Copy the changed areas
+    for (i = 0; i < rt->g.dirty.count; ++ i) {
+
+        r = &rt->g.dirty.rects[i];
+        for (y = r->y; y < r->y + r->h; ++ y) {
+
+            memcpy(g->pdata + y*g->csize.x + r->x,
+                rt->g.pdata + y*g->csize.x + r->x, r->w);
+        }
+        g_mark_dirty(g, r->x, r->y, r->w, r->h);
+    }
+    rt->g.dirty.count = 0;
+
+    // The next frame starts from the state the
+    // previous one left, but the canvas and
+    // the window stay
+    old = *g;
+    *g = rt->g;
+    g->rend = old.rend;
+    g->canvas = old.canvas;
+    g->windowSize = old.windowSize;
+    g->canvasPos = old.canvasPos;
+    g->canvasScale = old.canvasScale;
+    g->pdata = old.pdata;
+    g->cmdBuffer = old.cmdBuffer;
+    g->dirty = old.dirty;
+}
+
+
+// Start drawing
+void rt_submit(RenderThread* rt) {
+
+    SDL_LockMutex(rt->mutex);
+    rt->pending = rt->buffers[rt->current];
+    SDL_CondSignal(rt->start);
+    SDL_UnlockMutex(rt->mutex);
+
+    rt->current = (rt->current + 1) % 2;
+}
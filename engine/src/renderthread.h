@@ -0,0 +1,64 @@
+//
+// Render thread. Draws the recorded commands of
+// a frame while the next frame is updated
+// (c) 2019 Jani Nykänen
+//
+
+#ifndef __RENDER_THREAD__
+#define __RENDER_THREAD__
+
+#include "graphics.h"
+#include "cmdbuffer.h"
+#include "bandrenderer.h"
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+// Render thread type
+typedef struct {
+
+    SDL_Thread* thread;
+    SDL_mutex* mutex;
+    SDL_cond* start;
+    SDL_cond* done;
+
+    // Graphics the commands are drawn with, with
+    // a canvas of their own
+    Graphics g;
+    // Band renderer, NULL if not used
+    BandRenderer* br;
+
+    // Commands are recorded to one buffer while
+    // the other one is being drawn
+    CommandBuffer* buffers [2];
+    int current;
+    // Commands to draw, NULL if done
+    CommandBuffer* pending;
+
+    bool running;
+
+} RenderThread;
+
+// Create a render thread that draws with the
+// state of the given graphics. If "br" is not
+// NULL, the frames are drawn in bands with it
+RenderThread* create_render_thread(Graphics* g, 
+    BandRenderer* br, uint32 bufferSize);
+
+// Dispose a render thread
+void dispose_render_thread(RenderThread* rt);
+
+// Get the buffer to record the next frame to
+CommandBuffer* rt_get_buffer(RenderThread* rt);
+
+// Wait until the previous frame is drawn and copy
+// it to the canvas of "g". The state of "g" is
+// set to the state the frame was left to
+void rt_finish(RenderThread* rt, Graphics* g);
+
+// Start drawing the commands in the buffer
+// given by rt_get_buffer
+void rt_submit(RenderThread* rt);
+
+#endif // __RENDER_THREAD__
@@ -0,0 +1,192 @@
+#include "replay.h"
+
+#include "err.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// File format
+static const char REPLAY_MAGIC[4] = {'R', 'R', 'P', 'L'};
+#define REPLAY_VERSION 1
+
+
+// Read the next event to play
+static void read_next(Replay* r) {
+
+    // A file that ends early is played as far as it goes
+    if (fread(&r->next, sizeof(ReplayEvent), 1, r->file) != 1) {
+
+        r->next.type = ReplayEnd;
+        r->next.frame = r->frame;
+    }
+}
+
+
+// Create a replay recorder
+Replay* create_replay_recorder(const char* path,
+    uint32 seed, bool joyactive) {
+
+    // Allocate memory
+    Replay* r = (Replay*)malloc(sizeof(Replay));
+    if (r == NULL) {
+
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
+
+    r->file = fopen(path, "wb");
+    if (r->file == NULL) {
+
+        err_throw_param_1("Failed to open a file in ", path);
+        free(r);
+        return NULL;
+    }
+
+    r->mode = ReplayRecord;
+    r->frame = 0;
+    r->playing = false;
+
+    // Write header
+    memcpy(r->header.magic, REPLAY_MAGIC, 4);
+    r->header.version = REPLAY_VERSION;
+    r->header.seed = seed;
+    r->header.joyactive = joyactive ? 1 : 0;
+    fwrite(&r->header, sizeof(ReplayHeader), 1, r->file);
+
+    return r;
+}
+
+
+// Create a replay player
+Replay* create_replay_player(const char* path) {
+
+    // Allocate memory
+    Replay* r = (Replay*)malloc(sizeof(Replay));
+    if (r == NULL) {
+
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
+
+    r->file = fopen(path, "rb");
+    if (r->file == NULL) {
+
+        err_throw_param_1("Failed to open a file in ", path);
+        free(r);
+        return NULL;
+    }
+
+    // Read & check header
+    if (fread(&r->header, sizeof(ReplayHeader), 1, r->file) != 1 ||
+        memcmp(r->header.magic, REPLAY_MAGIC, 4) != 0 ||
+        r->header.version != REPLAY_VERSION) {
+
+        err_throw_param_1("Not a replay file: ", path);
+        fclose(r->file);
+        free(r);
+        return NULL;
+    }
+
+    r->mode = ReplayPlay;
+    r->frame = 0;
+    r->playing = true;
+    read_next(r);
+
+    return r;
+}
+
+
+// Dispose a replay
+void dispose_replay(Replay* r) {
+
+    ReplayEvent end;
+
+    if (r == NULL) return;
+
+    // Store the length
+    if (r->mode == ReplayRecord) {
+
+        memset(&end, 0, sizeof(ReplayEvent));
+        end.type = ReplayEnd;
+        end.frame = r->frame;
+        fwrite(&end, sizeof(ReplayEvent), 1, r->file);
+    }
+
+    fclose(r->file);
+    free(r);
+}
+
+
+// Record an input event
+void replay_record(Replay* r, int type,
+    int index, float x, float y) {
+
+    ReplayEvent e;
+
+    if (r->mode != ReplayRecord) return;
+
+    e.frame = r->frame;
+    e.type = (uint16)type;
+    e.index = (uint16)index;
+    e.x = x;
+    e.y = y;
+    fwrite(&e, sizeof(ReplayEvent), 1, r->file);
+}
+
+
+// Pass the events of the current frame to the input
+bool replay_play_frame(Replay* r, Input* input) {
+
+    ReplayEvent* e = &r->next;
+
+    if (!r->playing) return false;
+
+    // The recorded joystick events must not be
+    // ignored even if there is no joystick now
+    if (r->header.joyactive)
+        input->joyactive = true;
+
+    while (e->frame <= r->frame) {
+
+        switch (e->type)
+        {
+        case ReplayKeyDown:
+            event_key_down(input, e->index);
+            break;
+
+        case ReplayKeyUp:
+            event_key_up(input, e->index);
+            break;
+
+        case ReplayJoyDown:
+            event_joy_down(input, e->index);
+            break;
+
+        case ReplayJoyUp:
+            event_joy_up(input, e->index);
+            break;
+
+        case ReplayJoyMove:
+            event_joy_move(input, e->x, e->index);
+            break;
+
+        case ReplayJoyMoveAxes:
+            event_joy_move_axes(input, e->x, e->y);
+            break;
+
+        default:
+            r->playing = false;
+            return false;
+        }
+        read_next(r);
+    }
+
+    return true;
+}
+
+
+// Move to the next update frame
+void replay_next_frame(Replay* r) {
+
+    ++ r->frame;
+}
@@ -0,0 +1,102 @@
+//
+// Input recording & replay
+// (c) 2019 Jani Nykänen
+//
+
+#ifndef __REPLAY__
+#define __REPLAY__
+
+#include "types.h"
+#include "input.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+
+// Replay modes
+enum {
+
+    ReplayRecord = 0,
+    ReplayPlay = 1,
+};
+
+// Recorded input event types
+enum {
+
+    ReplayKeyDown = 0,
+    ReplayKeyUp = 1,
+    ReplayJoyDown = 2,
+    ReplayJoyUp = 3,
+    ReplayJoyMove = 4,
+    ReplayJoyMoveAxes = 5,
+    // Written last, frame is the number of
+    // frames in the replay
+    ReplayEnd = 6,
+};
+
+// Replay file header
+typedef struct {
+
+    char magic [4];
+    uint32 version;
+    // Random seed used when recording
+    uint32 seed;
+    // Was the joystick enabled
+    uint32 joyactive;
+
+} ReplayHeader;
+
+// Recorded event. Events are stored in the
+// file as they are, in the order of frames
+typedef struct {
+
+    // Update frame the event happened before
+    uint32 frame;
+    uint16 type;
+    // Key or button, or axis
+    uint16 index;
+    // Joystick position
+    float x, y;
+
+} ReplayEvent;
+
+// Replay type
+typedef struct {
+
+    int mode;
+    FILE* file;
+    ReplayHeader header;
+
+    // Number of updates so far
+    uint32 frame;
+    // Next event to play
+    ReplayEvent next;
+    // Are there events left to play
+    bool playing;
+
+} Replay;
+
+// Create a replay that records the input to
+// a file, with the given random seed
+Replay* create_replay_recorder(const char* path,
+    uint32 seed, bool joyactive);
+
+// Create a replay that plays the input
+// recorded in a file
+Replay* create_replay_player(const char* path);
+
+// Dispose a replay. The recording is
+// finished first
+void dispose_replay(Replay* r);
+
+// Record an input event
+void replay_record(Replay* r, int type,
+    int index, float x, float y);
+
+// Pass the events of the current frame to the input,
+// returns false if there is nothing left to play
+bool replay_play_frame(Replay* r, Input* input);
+
+// Move to the next update frame
+void replay_next_frame(Replay* r);
+
+#endif // __REPLAY__
@@ -36,6 +36,34 @@ Sample* load_sample(const char* path) {
 }
 
 
+// Create a sample from data in the mixer format
+Sample* create_sample(Uint8* data, Uint32 length) {
+
+    // Allocate memory for a sample
+    Sample* s = (Sample*)malloc(sizeof(Sample));
+    if (s == NULL) {
+
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
+
+    // The chunk does not own the data, so it
+    // is not freed with the chunk
+    s->chunk = Mix_QuickLoad_RAW(data, length);
+    if (s->chunk == NULL) {
+
+        err_throw_param_1("Failed to create a sample: ", Mix_GetError());
+        free(s);
+        return NULL;
+    }
+
+    s->played = false;
+    s->channel = -1;
+
+    return s;
+}
+
+
 // Destroy a sample
 void sample_destroy(Sample* s) {
 
@@ -10,6 +10,11 @@
 
 #include <stdbool.h>
 
+// Mixer output format
+#define SAMPLE_FREQ 22050
+#define SAMPLE_FORMAT MIX_DEFAULT_FORMAT
+#define SAMPLE_CHANNELS 2
+
 // Sample type
 typedef struct {
 
@@ -22,6 +27,11 @@ typedef struct {
 // Load a sample
 Sample* load_sample(const char* path);
 
+// Create a sample that plays data in the
+// mixer output format. The data is not copied
+// and must exist until the sample is destroyed
+Sample* create_sample(Uint8* data, Uint32 length);
+
 // Destroy a sample
 void sample_destroy(Sample* s);
 
@@ -0,0 +1,159 @@
+#include "workerpool.h"
+
+#include "err.h"
+#include "mathext.h"
+
+#include <stdlib.h>
+
+
+// Run jobs until there are none left. Expects the
+// mutex to be locked
+static void run_jobs(WorkerPool* pool) {
+
+    int index;
+
+    while (pool->nextJob < pool->jobCount) {
+
+        index = pool->nextJob ++;
+
+        SDL_UnlockMutex(pool->mutex);
+        pool->job(pool->param, index);
+        SDL_LockMutex(pool->mutex);
+
+        if (-- pool->jobsLeft == 0)
+            SDL_CondBroadcast(pool->done);
+    }
+}
+
+
+// Worker thread
+static int thread_worker(void* p) {
+
+    WorkerPool* pool = (WorkerPool*)p;
+
+    SDL_LockMutex(pool->mutex);
+    while (pool->running) {
+
+        run_jobs(pool);
+        if (pool->running)
+            SDL_CondWait(pool->start, pool->mutex);
+    }
+    SDL_UnlockMutex(pool->mutex);
+
+    return 0;
+}
+
+
+// Create a worker pool
+WorkerPool* create_worker_pool(int threadCount) {
+
+    int i;
+
+    // Allocate memory
+    WorkerPool* pool = (WorkerPool*)malloc(sizeof(WorkerPool));
+    if (pool == NULL) {
+
+        ERR_MEM_ALLOC;
+        return NULL;
+    }
+    pool->threads = (SDL_Thread**)calloc(
+        max_int32_2(threadCount, 1), sizeof(SDL_Thread*));
+    if (pool->threads == NULL) {
+
+        ERR_MEM_ALLOC;
+        free(pool);
+        return NULL;
+    }
+    pool->threadCount = 0;
+
+    pool->job = NULL;
+    pool->param = NULL;
+    pool->jobCount = 0;
+    pool->nextJob = 0;
+    pool->jobsLeft = 0;
+    pool->running = true;
+
+    // Create synchronization objects
+    pool->mutex = SDL_CreateMutex();
+    pool->start = SDL_CreateCond();
+    pool->done = SDL_CreateCond();
+    if (pool->mutex == NULL || pool->start == NULL || pool->done == NULL) {
+
+        err_throw_param_1("Failed to create a worker pool: ", SDL_GetError());
+        dispose_worker_pool(pool);
+        return NULL;
+    }
+
+    // Start threads
+    for (i = 0; i < threadCount; ++ i) {
+
+        pool->threads[i] = SDL_CreateThread(thread_worker,
+            "thread_worker", (void*)pool);
+        if (pool->threads[i] == NULL) {
+
+            err_throw_param_1("Failed to create a thread: ", SDL_GetError());
+            dispose_worker_pool(pool);
+            return NULL;
+        }
+        ++ pool->threadCount;
+    }
+
+    return pool;
+}
+
+
+// Dispose a worker pool
+void dispose_worker_pool(WorkerPool* pool) {
+
+    int i;
+
+    if (pool == NULL) return;
+
+    // Stop threads
+    if (pool->mutex != NULL && pool->start != NULL) {
+
+        SDL_LockMutex(pool->mutex);
+        pool->running = false;
+        SDL_CondBroadcast(pool->start);
+        SDL_UnlockMutex(pool->mutex);
+    }
+    for (i = 0; i < pool->threadCount; ++ i) {
+
+        SDL_WaitThread(pool->threads[i], NULL);
+    }
+
+    if (pool->done != NULL)
+        SDL_DestroyCond(pool->done);
+    if (pool->start != NULL)
+        SDL_DestroyCond(pool->start);
+    if (pool->mutex != NULL)
+        SDL_DestroyMutex(pool->mutex);
+
+    free(pool->threads);
+    free(pool);
+}
+
+
+// Run "count" jobs and wait until they are done
+void pool_run(WorkerPool* pool, WorkerJob job, void* param, int count) {
+
+    if (count <= 0) return;
+
+    SDL_LockMutex(pool->mutex);
+
+    pool->job = job;
+    pool->param = param;
+    pool->jobCount = count;
+    pool->nextJob = 0;
+    pool->jobsLeft = count;
+    SDL_CondBroadcast(pool->start);
+
+    // Help the workers, then wait for the rest
+    run_jobs(pool);
+    while (pool->jobsLeft > 0) {
+
+        SDL_CondWait(pool->done, pool->mutex);
+    }
+
+    SDL_UnlockMutex(pool->mutex);
+}
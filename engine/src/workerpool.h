@@ -0,0 +1,52 @@
+//
+// Worker pool
+// (c) 2019 Jani Nykänen
+//
+
+#ifndef __WORKER_POOL__
+#define __WORKER_POOL__
+
+#include "types.h"
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+// Job function, gets the job index
+typedef void (*WorkerJob) (void* param, int index);
+
+// Worker pool type
+typedef struct {
+
+    // Threads
+    SDL_Thread** threads;
+    int threadCount;
+
+    // Synchronization
+    SDL_mutex* mutex;
+    SDL_cond* start;
+    SDL_cond* done;
+
+    // Current job
+    WorkerJob job;
+    void* param;
+    int jobCount;
+    int nextJob;
+    int jobsLeft;
+
+    bool running;
+
+} WorkerPool;
+
+// Create a worker pool. The calling thread takes
+// part in the work, so "threadCount" threads are
+// created in addition to it
+WorkerPool* create_worker_pool(int threadCount);
+
+// Dispose a worker pool
+void dispose_worker_pool(WorkerPool* pool);
+
+// Run "count" jobs and wait until they are done
+void pool_run(WorkerPool* pool, WorkerJob job, void* param, int count);
+
+#endif // __WORKER_POOL__
@@ -1,10 +1,16 @@
 #include "explosion.h"
 
+#include <engine/mathext.h>
+
 #include <math.h>
 
 // Constants
 static const float EXP_TIME_BASE = 15.0f;
 
+// Shaking is done when drawing, so it must
+// not use the random numbers of the game logic
+static uint32 shakeState = 1;
+
 
 // Create an explosion
 Explosion create_explosion() {
@@ -70,10 +76,10 @@ void exp_draw(Explosion* e, Graphics* g) {
         
         angle = i * step;
         g_draw_triangle(g,
-            x + (int)(cosf(angle) * r),
-            y + (int)(sinf(angle) * r),
-            x + (int)(cosf((i+1)*step) * r),
-            y + (int)(sinf((i+1)*step) * r),
+            x + (int)(fast_cos(angle) * r),
+            y + (int)(fast_sin(angle) * r),
+            x + (int)(fast_cos((i+1)*step) * r),
+            y + (int)(fast_sin((i+1)*step) * r),
             x, y, 255
             );
     }
@@ -93,8 +99,8 @@ void exp_shake(Explosion* e,  Graphics* g) {
         
         g_move_to(
             g,
-            (rand() % (a*2) ) - a,
-            (rand() % (a*2) ) - a
+            (int)(xorshift32(&shakeState) % (a*2) ) - a,
+            (int)(xorshift32(&shakeState) % (a*2) ) - a
         );
     }
 }
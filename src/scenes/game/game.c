@@ -3,9 +3,9 @@
 #include <engine/eventmanager.h>
 #include <engine/graphics.h>
 #include <engine/mathext.h>
+#include <engine/profiler.h>
 
 #include <stdlib.h>
-#include <time.h>
 #include <math.h>
 #include <stdio.h>
 
@@ -588,7 +588,12 @@ static void game_reset() {
 // Initialize
 static int game_init(void* e) {
 
-    srand(time(NULL));
+    // Random numbers are seeded by the core,
+    // so that the input can be replayed
+
+    // Find the player buttons, the key
+    // configuration is read already
+    init_player_buttons(((EventManager*)e)->vpad);
 
     // Create pause menu
     pause = create_pause_menu();
@@ -730,18 +735,26 @@ static void game_update(void* e, float tm) {
     float speed = globalSpeed * PERSPECTIVE_SPEED_MUL;
 
     // Update stage
+    Uint64 zone = prof_begin();
     stage_update(&stage, globalSpeed, tm);
+    prof_end("stage_update", zone);
 
     // Update player
+    zone = prof_begin();
     pl_update(&player, evMan, speed, tm,    
         (void*)coins, COIN_COUNT,
         messages, MSG_COUNT);
+    prof_end("pl_update", zone);
 
     // Update enemy generator
+    zone = prof_begin();
     update_enemy_generator(speed, tm);
     // Update mushroom generator
     update_mushroom_generator(speed, tm);
+    prof_end("game_update: generators", zone);
+
     // Update mushrooms
+    zone = prof_begin();
     for (i = 0; i < MUSHROOM_COUNT; ++ i) {
 
         mush_update(&mushrooms[i], speed, tm);
@@ -780,7 +793,10 @@ static void game_update(void* e, float tm) {
         }
     }
 
+    prof_end("game_update: objects", zone);
+
     // Update coins
+    zone = prof_begin();
     for (i = 0; i < COIN_COUNT; ++ i) {
 
         coin_update(&coins[i], speed, evMan, tm);
@@ -792,6 +808,7 @@ static void game_update(void* e, float tm) {
 
         msg_update(&messages[i], tm);
     }
+    prof_end("game_update: coins & messages", zone);
 
     // Update stats
     stats_update(&stats, tm);
@@ -1201,9 +1218,12 @@ static void game_draw(Graphics* g) {
     pl_shake(&player, g);
 
     // Draw stage
+    Uint64 zone = prof_begin();
     stage_draw(&stage, g);
+    prof_end("stage_draw", zone);
 
     // Draw spikeball shadows
+    zone = prof_begin();
     for (i = 0; i < SPIKEBALL_COUNT; ++ i) {
 
         sb_draw_shadow(&spikeballs[i], g);
@@ -1238,10 +1258,13 @@ static void game_draw(Graphics* g) {
     // Draw explosion
     pl_draw_explosion(&player, g);
 
+    prof_end("game_draw: objects", zone);
+
     // Remove shaking
     g_move_to(g, 0, 0);
 
     // Draw coins
+    zone = prof_begin();
     for (i = 0; i < COIN_COUNT; ++ i) {
 
         coin_draw(&coins[i], g);
@@ -1253,7 +1276,10 @@ static void game_draw(Graphics* g) {
         msg_draw(&messages[i], g, bmpFont);
     }
 
+    prof_end("game_draw: coins & messages", zone);
+
     // Draw HUD
+    zone = prof_begin();
     game_draw_hud(g);
 
     // Draw self-destruct box
@@ -1263,7 +1289,7 @@ static void game_draw(Graphics* g) {
     game_draw_guide(g, false);
     // Draw preparation screen
     game_draw_prep_screen(g);
-
+    prof_end("game_draw: HUD", zone);
 }
 
 
@@ -108,17 +108,15 @@ void pause_draw(PauseMenu* pm, Graphics* g) {
 
     if (!pm->active) return;
 
-    // Copy buffer
+    // Store the darkened game screen
     if (!pm->bufferCopied) {
 
-        g_copy_to_buffer(g);
+        g_freeze_backdrop(g, DVALUE_BG);
         pm->bufferCopied = true;
     }
 
-    // Draw buffer as a background
-    g_draw_bitmap_fast(g, &g->bufferCopy, 0, 0);
-    // Darken
-    g_darken(g, DVALUE_BG);
+    // Draw it as a background
+    g_draw_backdrop(g);
 
     int x = g->csize.x/2 + XOFF;
     int y = g->csize.y/2 + YOFF;
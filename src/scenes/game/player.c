@@ -23,6 +23,11 @@ static Sample* sExplode;
 static Sample* sDetonate;
 static Sample* sSpawn;
 
+// Button handles, checked every frame
+static int btnJump;
+static int btnShoot;
+static int btnDetonate;
+
 // Constants
 static const float JUMP_REACT_MIN_TIME = 1.0f;
 static const float JUMP_EXTEND_TIME = 10.0f;
@@ -53,6 +58,15 @@ void init_global_player(AssetManager* a) {
 }
 
 
+// Find the buttons used by the player
+void init_player_buttons(Gamepad* vpad) {
+
+    btnJump = pad_get_button_handle(vpad, "fire1");
+    btnShoot = pad_get_button_handle(vpad, "fire2");
+    btnDetonate = pad_get_button_handle(vpad, "fire3");
+}
+
+
 // Update axis
 static void update_axis(float* axis, 
     float* speed, float target, float delta, float tm) {
@@ -195,7 +209,7 @@ static void pl_control(Player* pl, EventManager* evMan, float tm,
     }
 
     // Jumping
-    State fire1 = pad_get_button_state(evMan->vpad, "fire1");
+    State fire1 = pad_get_button_state_by_handle(evMan->vpad, btnJump);
     if (!pl->extendJump && 
         pl->jumpTimer > JUMP_REACT_MIN_TIME && pl->doubleJump && 
         (fire1 == StatePressed || fire1 == StateDown)) {
@@ -236,7 +250,7 @@ static void pl_control(Player* pl, EventManager* evMan, float tm,
     int level = pl->stats->powerLevel;
     int points;
     float oldTimer = pl->selfDestructTimer;
-    if (pad_get_button_state(evMan->vpad, "fire3") == StateDown) {
+    if (pad_get_button_state_by_handle(evMan->vpad, btnDetonate) == StateDown) {
 
         if (oldTimer <= 0.0f && !pl->dying) {
 
@@ -427,7 +441,7 @@ static void pl_update_bullets(Player* pl, EventManager* evMan, float tm) {
     const float REDUCE_POWER_BIG = 0.6f;
 
     int i;
-    int s = pad_get_button_state(evMan->vpad, "fire2");
+    int s = pad_get_button_state_by_handle(evMan->vpad, btnShoot);
 
     // Create a bullet
     Bullet* b = NULL;
@@ -828,9 +842,9 @@ void pl_draw_entrance_portal(Player* pl, Graphics* g) {
     g_set_pixel_function(g, PixelFunctionDarken, dvalue, 0);
     g_draw_triangle(
         g, 
-        cx + (int)(cosf(angle)*r), cy + (int)(sinf(angle)*r),
-        cx + (int)(cosf(angle+step)*r), cy + (int)(sinf(angle+step)*r),
-        cx + (int)(cosf(angle+step*2)*r), cy + (int)(sinf(angle+step*2)*r),
+        cx + (int)(fast_cos(angle)*r), cy + (int)(fast_sin(angle)*r),
+        cx + (int)(fast_cos(angle+step)*r), cy + (int)(fast_sin(angle+step)*r),
+        cx + (int)(fast_cos(angle+step*2)*r), cy + (int)(fast_sin(angle+step*2)*r),
         255
     );
     g_set_pixel_function(g, PixelFunctionDefault, 0, 0);
@@ -937,7 +951,7 @@ void pl_draw(Player* pl, Graphics* g) {
 
         g_draw_bitmap(g, bmpArrow, 
             px-24, 
-            ARROW_Y + (int)(sinf(pl->arrowWave)*ARROW_AMPLITUDE), 
+            ARROW_Y + (int)(fast_sin(pl->arrowWave)*ARROW_AMPLITUDE), 
             false);
     }
 }
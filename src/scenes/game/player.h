@@ -28,6 +28,9 @@
 // Init global data
 void init_global_player(AssetManager* a);
 
+// Find the buttons used by the player
+void init_player_buttons(Gamepad* vpad);
+
 // Player type
 typedef struct {
 
@@ -213,12 +213,12 @@ void sb_draw_shadow(Spikeball* b, Graphics* g) {
 static void draw_chain(Graphics* g, 
     int dx1, int dy1, int dx2, int dy2, int r) {
 
-    float angle = atan2f(dy2-dy1, dx2-dx1) + M_PI/2.0f;
+    float angle = fast_atan2(dy2-dy1, dx2-dx1) + M_PI/2.0f;
     float len = hypotf(dx2-dx1, dy2-dy1);
     float texRepeat = len / (float)bmpChain->height;
 
-    float c = cosf(angle);
-    float s = sinf(angle);
+    float c = fast_cos(angle);
+    float s = fast_sin(angle);
 
     int x1 = dx1-(int)(c*r/2);
     int y1 = dy1-(int)(s*r/2);
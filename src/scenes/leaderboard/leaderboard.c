@@ -193,15 +193,14 @@ static void lboard_draw(Graphics* g) {
     int i;
     char buf [LB_NAME_LENGTH +3];
 
-    // Copy buffer & draw it
+    // Store the darkened screen & draw it
     if (!bufferCopied) {
 
-        g_copy_to_buffer(g);
+        g_set_darkness_color(g, 0);
+        g_freeze_backdrop(g, DVALUE);
         bufferCopied = true;
     }
-    g_draw_bitmap(g, &g->bufferCopy, 0, 0, false);
-    g_set_darkness_color(g, 0);
-    g_darken(g, DVALUE);
+    g_draw_backdrop(g);
 
     // Draw box
     for (i = 0; i < BOX_OUTLINES; ++ i) {
@@ -3,6 +3,7 @@
 #include "../../menu.h"
 
 #include <engine/eventmanager.h>
+#include <engine/mathext.h>
 
 #include <math.h>
 #include <stdlib.h>
@@ -171,10 +172,10 @@ static void title_draw_background(Graphics* g) {
 
         g_draw_triangle(
             g,
-            cx + (int)(cosf(-spiralAngle - step*i) * RADIUS),
-            cy + (int)(sinf(-spiralAngle - step*i) * RADIUS),
-            cx + (int)(cosf(-spiralAngle - step*(i+1)) * RADIUS),
-            cy + (int)(sinf(-spiralAngle - step*(i+1)) * RADIUS),
+            cx + (int)(fast_cos(-spiralAngle - step*i) * RADIUS),
+            cy + (int)(fast_sin(-spiralAngle - step*i) * RADIUS),
+            cx + (int)(fast_cos(-spiralAngle - step*(i+1)) * RADIUS),
+            cy + (int)(fast_sin(-spiralAngle - step*(i+1)) * RADIUS),
             cx,
             cy,
             COLORS[i % 2]
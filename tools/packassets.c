@@ -0,0 +1,279 @@
+//
+// Asset packer. Converts the assets in an
+// asset file to the formats used by the engine
+// (c) 2019 Jani Nykänen
+//
+
+#include <engine/assetpack.h>
+#include <engine/wordreader.h>
+#include <engine/err.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Maximum number of packed assets
+#define MAX_ENTRIES 256
+
+
+// Write zeroes until the next payload position
+static void align_file(FILE* f) {
+
+    static const uint8 ZEROES [PACK_ALIGN] = {0};
+    long pos = ftell(f);
+
+    if (pos % PACK_ALIGN != 0)
+        fwrite(ZEROES, 1, PACK_ALIGN - pos % PACK_ALIGN, f);
+}
+
+
+// Write a bitmap
+static int pack_bitmap(FILE* f, PackEntry* e) {
+
+    PackBitmap b;
+
+    Bitmap* bmp = load_bitmap(e->path, e->flag != 0);
+    if (bmp == NULL) {
+
+        return -1;
+    }
+
+    b.width = bmp->width;
+    b.height = bmp->height;
+    b.runCount = bmp->runRows[bmp->height];
+
+    fwrite(&b, sizeof(PackBitmap), 1, f);
+    fwrite(bmp->runRows, sizeof(uint32), bmp->height+1, f);
+    fwrite(bmp->runs, sizeof(uint16), 2 * b.runCount, f);
+    fwrite(bmp->data, 1, bmp->width*bmp->height, f);
+
+    destroy_bitmap(bmp);
+
+    return 0;
+}
+
+
+// Write a sample, converted to the mixer format
+static int pack_sample(FILE* f, PackEntry* e) {
+
+    SDL_AudioSpec spec;
+    SDL_AudioCVT cvt;
+    Uint8* buf;
+    Uint32 len;
+    int ret;
+
+    if (SDL_LoadWAV(e->path, &spec, &buf, &len) == NULL) {
+
+        err_throw_param_1("Could not load a WAV file in ", e->path);
+        return -1;
+    }
+
+    ret = SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq,
+        SAMPLE_FORMAT, SAMPLE_CHANNELS, SAMPLE_FREQ);
+    if (ret < 0) {
+
+        err_throw_param_1("Cannot convert the audio in ", e->path);
+        SDL_FreeWAV(buf);
+        return -1;
+    }
+
+    // Already in the right format
+    if (ret == 0) {
+
+        fwrite(buf, 1, len, f);
+        SDL_FreeWAV(buf);
+        return 0;
+    }
+
+    cvt.len = (int)len;
+    cvt.buf = (Uint8*)malloc((size_t)len * cvt.len_mult);
+    if (cvt.buf == NULL) {
+
+        ERR_MEM_ALLOC;
+        SDL_FreeWAV(buf);
+        return -1;
+    }
+    memcpy(cvt.buf, buf, len);
+    SDL_FreeWAV(buf);
+
+    if (SDL_ConvertAudio(&cvt) != 0) {
+
+        err_throw_param_1("Cannot convert the audio in ", e->path);
+        free(cvt.buf);
+        return -1;
+    }
+    fwrite(cvt.buf, 1, cvt.len_cvt, f);
+    free(cvt.buf);
+
+    return 0;
+}
+
+
+// Read the assets to pack from an asset file
+static int read_entries(const char* path, PackEntry* entries, int* count) {
+
+    WordReader* wr = create_word_reader(path);
+    if (wr == NULL) {
+
+        return -1;
+    }
+
+    int c = 0;
+    int type = -1;
+    bool dithering = false;
+    char name [WR_WORD_LENGTH];
+    PackEntry* e;
+
+    *count = 0;
+    while (wr_read_next(wr)) {
+
+        // Type
+        if (c == 0) {
+
+            type = -1;
+            if (strcmp(wr->word, "bitmap") == 0)
+                type = PackTypeBitmap;
+            else if (strcmp(wr->word, "sample") == 0)
+                type = PackTypeSample;
+            // Flags are read, other assets are
+            // still loaded from their files
+            else if (strcmp(wr->word, "flag") == 0)
+                type = -2;
+        }
+        // Name
+        else if (c == 1) {
+
+            snprintf(name, WR_WORD_LENGTH, "%s", wr->word);
+        }
+        // Path
+        else if (c == 2) {
+
+            if (type == -2 && strcmp(name, "dither") == 0) {
+
+                dithering = (int)(strtol(wr->word, NULL, 10)) == 1;
+            }
+            else if (type >= 0) {
+
+                if (*count == MAX_ENTRIES) {
+
+                    err_throw_no_param("Too many assets to pack.");
+                    dispose_word_reader(wr);
+                    return -1;
+                }
+
+                // A shortened name would not be found
+                if (strlen(name) >= PACK_NAME_LENGTH) {
+
+                    err_throw_param_1("Asset name too long: ", name);
+                    dispose_word_reader(wr);
+                    return -1;
+                }
+
+                e = &entries[(*count) ++];
+                memset(e, 0, sizeof(PackEntry));
+                memcpy(e->name, name, strlen(name)+1);
+                snprintf(e->path, PACK_PATH_LENGTH, "%s", wr->word);
+                e->type = (uint32)type;
+                e->flag = (type == PackTypeBitmap && dithering) ? 1 : 0;
+
+                if (pack_get_source_info(e->path, 
+                    &e->sourceSize, &e->sourceTime) == -1) {
+
+                    err_throw_param_1("Failed to open a file in ", e->path);
+                    dispose_word_reader(wr);
+                    return -1;
+                }
+            }
+        }
+
+        ++ c;
+        c %= 3;
+    }
+
+    dispose_word_reader(wr);
+
+    return 0;
+}
+
+
+// Write the pack
+static int write_pack(const char* path, PackEntry* entries, int count) {
+
+    int i;
+    int ret = 0;
+    PackHeader h;
+    long start;
+
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+
+        err_throw_param_1("Failed to create a file in ", path);
+        return -1;
+    }
+
+    memset(&h, 0, sizeof(PackHeader));
+    memcpy(h.magic, PACK_MAGIC, 4);
+    h.version = PACK_VERSION;
+    h.entryCount = (uint32)count;
+    h.sampleFreq = SAMPLE_FREQ;
+    h.sampleFormat = SAMPLE_FORMAT;
+    h.sampleChannels = SAMPLE_CHANNELS;
+
+    // The index is written again when the
+    // positions are known
+    fwrite(&h, sizeof(PackHeader), 1, f);
+    fwrite(entries, sizeof(PackEntry), count, f);
+
+    for (i = 0; i < count && ret == 0; ++ i) {
+
+        align_file(f);
+        start = ftell(f);
+
+        if (entries[i].type == PackTypeBitmap)
+            ret = pack_bitmap(f, &entries[i]);
+        else
+            ret = pack_sample(f, &entries[i]);
+
+        entries[i].offset = (uint32)start;
+        entries[i].size = (uint32)(ftell(f) - start);
+    }
+
+    fseek(f, sizeof(PackHeader), SEEK_SET);
+    fwrite(entries, sizeof(PackEntry), count, f);
+
+    if (fclose(f) != 0 && ret == 0) {
+
+        err_throw_param_1("Failed to write a file in ", path);
+        ret = -1;
+    }
+    // Do not leave a broken pack behind
+    if (ret != 0) {
+
+        remove(path);
+    }
+
+    return ret;
+}
+
+
+int main(int argc, char** argv) {
+
+    static PackEntry entries [MAX_ENTRIES];
+    int count;
+
+    if (argc != 3) {
+
+        printf("Usage: %s <asset file> <pack file>\n", argv[0]);
+        return 1;
+    }
+
+    if (read_entries(argv[1], entries, &count) != 0 ||
+        write_pack(argv[2], entries, count) != 0) {
+
+        printf("Failed to pack the assets: %s\n", get_error());
+        return 1;
+    }
+    printf("Packed %d assets to %s\n", count, argv[2]);
+
+    return 0;
+}